@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  archive.c
+#contents :  arc_open(), arc_begin(), arc_end(), arc_close(), arc_extract()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : misc.c, zlib (if HAVE_ZLIB), pthread
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  block-compressed seekable dump archive
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * file layout
+ *
+ *   header  "MVIEWARC", u32 version, u32 block size
+ *   blocks  each one compressed by itself
+ *   index   nblock * { u64 offset, u32 compressed length, u32 raw length }
+ *           nmsg   * { u32 block, u32 offset in block, u32 length }
+ *   footer  u64 nblock, u64 nmsg, u64 offset of index, "MVIEWEND"
+ *
+ * a compressed length of 0 means the block is stored as it is.
+ * message N of the index is what "-o" would write down to dump_N,
+ * and it never spans blocks, so one block is inflated to extract it.
+ *
+ * the blocks are compressed by "nthread" threads. the slots form a
+ * ring, the main thread fills the tail and writes the head down in
+ * order once it is compressed, and waits when the ring is full.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <pthread.h>
+#include "mview.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"archive.c"
+
+#define ARC_MAGIC	"MVIEWARC"
+#define ARC_END		"MVIEWEND"
+#define ARC_VERSION	1
+#define ARC_BLOCK	(1024 * 1024)
+#define ARC_ZLEVEL	Z_DEFAULT_COMPRESSION
+#define MAX_THREAD	64
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+enum {
+	S_FREE		= 0,
+	S_READY		= 1,	/* filled, wait for compression */
+	S_BUSY		= 2,	/* under compression */
+	S_DONE		= 3	/* wait for writing */
+};
+
+typedef struct _slot {
+	Buf raw;
+	Buf comp;
+	int state;
+} Slot;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static FILE *parc	= NULL;
+static int nthread	= 0;
+static pthread_t thread[MAX_THREAD];
+static pthread_mutex_t lock	= PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready	= PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done	= PTHREAD_COND_INITIALIZER;
+static int quit		= 0;
+
+static Slot *slot	= NULL;
+static int nslot	= 0;
+static unsigned long head	= 0;	/* next slot to write */
+static unsigned long tail	= 0;	/* slot being filled */
+
+static Buf bindex;	/* index of blocks */
+static Buf mindex;	/* index of messages */
+static uint64_t nblock	= 0;
+static uint64_t nmsg	= 0;
+
+static char *mbuf	= NULL;	/* message of arc_begin() */
+static size_t mlen	= 0;
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void arc_open(const char *, int);
+FILE *arc_begin(void);
+void arc_end(FILE *);
+void arc_close(void);
+int arc_extract(const char *, unsigned long, FILE *);
+static void deflate_block(Slot *);
+static void *worker(void *);
+static void submit(void);
+static void drain(int);
+
+
+/********************************************
+ * compress a block
+ ********************************************
+*/
+void deflate_block (Slot *s)
+{
+	s->comp.len = 0;
+#ifdef HAVE_ZLIB
+	uLongf n = compressBound(s->raw.len);
+
+	if (s->comp.size < n) {
+		s->comp.size = n;
+		Realloc(s->comp.data, s->comp.size);
+	}
+	if (compress2((Bytef *)s->comp.data, &n, (Bytef *)s->raw.data,
+		      s->raw.len, ARC_ZLEVEL) == Z_OK && n < s->raw.len) {
+		s->comp.len = n;
+	}
+#endif
+}
+
+/********************************************
+ * compression thread
+ ********************************************
+*/
+void *worker (void *arg)
+{
+	Slot *s;
+
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		s = NULL;
+		for (unsigned long i = head; i < tail; i++) {
+			if (slot[i % nslot].state == S_READY) {
+				s = &slot[i % nslot];
+				break;
+			}
+		}
+		if (s == NULL) {
+			if (quit) {
+				break;
+			}
+			pthread_cond_wait(&ready, &lock);
+			continue;
+		}
+
+		s->state = S_BUSY;
+		pthread_mutex_unlock(&lock);
+		deflate_block(s);
+		pthread_mutex_lock(&lock);
+		s->state = S_DONE;
+		pthread_cond_broadcast(&done);
+	}
+	pthread_mutex_unlock(&lock);
+
+	return arg;
+}
+
+/********************************************
+ * write down compressed blocks in order
+ ********************************************
+ *
+ * wait for the head if "wait" is set, otherwise write down only
+ * the blocks which are already compressed.
+ *
+*/
+void drain (int wait)
+{
+	Slot *s;
+	uint64_t off;
+	uint32_t n[2];
+
+	pthread_mutex_lock(&lock);
+	while (head < tail) {
+		s = &slot[head % nslot];
+		if (s->state != S_DONE) {
+			if (!wait) {
+				break;
+			}
+			pthread_cond_wait(&done, &lock);
+			continue;
+		}
+		pthread_mutex_unlock(&lock);
+
+		off = ftello(parc);
+		n[0] = (uint32_t)s->comp.len;
+		n[1] = (uint32_t)s->raw.len;
+		bufput(&bindex, &off, sizeof(off));
+		bufput(&bindex, n, sizeof(n));
+		if (n[0]) {
+			fwrite(s->comp.data, 1, s->comp.len, parc);
+		}
+		else {
+			fwrite(s->raw.data, 1, s->raw.len, parc);
+		}
+		nblock++;
+
+		pthread_mutex_lock(&lock);
+		s->raw.len = 0;
+		s->state = S_FREE;
+		head++;
+		wait = wait > 1 ? wait : 0;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/********************************************
+ * hand the block being filled to the threads
+ ********************************************
+*/
+void submit (void)
+{
+	Slot *s = &slot[tail % nslot];
+
+	if (s->raw.len == 0) {
+		return;
+	}
+
+	if (nthread == 0) {
+		deflate_block(s);
+		s->state = S_DONE;
+		tail++;
+		drain(1);
+		return;
+	}
+
+	pthread_mutex_lock(&lock);
+	s->state = S_READY;
+	tail++;
+	pthread_cond_signal(&ready);
+	pthread_mutex_unlock(&lock);
+
+	/* write down what is done, wait for the head if the ring is full */
+	drain(tail - head >= (unsigned long)nslot);
+}
+
+/********************************************
+ * open archive
+ ********************************************
+*/
+void arc_open (const char *file, int threads)
+{
+	uint32_t h[2];
+
+	Fopen(parc, file, "w");
+	if (parc == NULL) {
+		exit(1);
+	}
+#ifndef HAVE_ZLIB
+	sys_err(" **warning** built without zlib, archive is not compressed",
+		SOURCE, __LINE__, 0);
+#endif
+
+	nthread = threads < 0 ? 0 : (threads > MAX_THREAD ? MAX_THREAD : threads);
+	nslot = nthread ? nthread * 2 : 1;
+	Calloc(slot, nslot, sizeof(Slot));
+
+	for (int i = 0; i < nthread; i++) {
+		if (pthread_create(&thread[i], NULL, worker, NULL)) {
+			sys_err(" ***error*** pthread_create failure", SOURCE, __LINE__, 0);
+			exit(1);
+		}
+	}
+
+	h[0] = ARC_VERSION;
+	h[1] = ARC_BLOCK;
+	fwrite(ARC_MAGIC, 1, strlen(ARC_MAGIC), parc);
+	fwrite(h, sizeof(uint32_t), 2, parc);
+}
+
+/********************************************
+ * begin a message
+ ********************************************
+ *
+ * returns a stream to write down a message instead of dump_N,
+ * the message goes into the archive by arc_end().
+ *
+*/
+FILE *arc_begin (void)
+{
+	FILE *o;
+
+	if ((o = open_memstream(&mbuf, &mlen)) == NULL) {
+		sys_err(" ***error*** open_memstream failure", SOURCE, __LINE__, 0);
+		exit(1);
+	}
+
+	return o;
+}
+
+/********************************************
+ * end a message
+ ********************************************
+*/
+void arc_end (FILE *o)
+{
+	Slot *s;
+	uint32_t m[3];
+
+	Fclose(o);
+
+	s = &slot[tail % nslot];
+	if (s->raw.len > 0 && s->raw.len + mlen > ARC_BLOCK) {
+		submit();
+		s = &slot[tail % nslot];
+	}
+
+	m[0] = (uint32_t)(nblock + (tail - head));
+	m[1] = (uint32_t)s->raw.len;
+	m[2] = (uint32_t)mlen;
+	bufput(&mindex, m, sizeof(m));
+	bufput(&s->raw, mbuf, mlen);
+	nmsg++;
+
+	Efree(mbuf);
+	mbuf = NULL;
+	mlen = 0;
+}
+
+/********************************************
+ * close archive
+ ********************************************
+*/
+void arc_close (void)
+{
+	uint64_t f[3];
+
+	if (parc == NULL) {
+		return;
+	}
+
+	submit();
+	drain(2);
+
+	pthread_mutex_lock(&lock);
+	quit = 1;
+	pthread_cond_broadcast(&ready);
+	pthread_mutex_unlock(&lock);
+	for (int i = 0; i < nthread; i++) {
+		pthread_join(thread[i], NULL);
+	}
+
+	f[0] = nblock;
+	f[1] = nmsg;
+	f[2] = ftello(parc);
+	fwrite(bindex.data, 1, bindex.len, parc);
+	fwrite(mindex.data, 1, mindex.len, parc);
+	fwrite(f, sizeof(uint64_t), 3, parc);
+	fwrite(ARC_END, 1, strlen(ARC_END), parc);
+
+	if (ferror(parc)) {
+		sys_err(" ***error*** archive write failure", SOURCE, __LINE__, 0);
+	}
+	Fclose(parc);
+	parc = NULL;
+
+	for (int i = 0; i < nslot; i++) {
+		buffree(&slot[i].raw);
+		buffree(&slot[i].comp);
+	}
+	Efree(slot);
+	buffree(&bindex);
+	buffree(&mindex);
+}
+
+/********************************************
+ * extract a message
+ ********************************************
+ *
+ * write down message "n" (1, 2, ...) of the archive to "o",
+ * only the block holding it is read and inflated.
+ *
+*/
+int arc_extract (const char *file, unsigned long n, FILE *o)
+{
+	FILE *in;
+	char magic[8];
+	uint64_t f[3];
+	uint64_t boff;
+	uint32_t b[2];
+	uint32_t m[3];
+	char *raw = NULL;
+	char *comp = NULL;
+	int rc = -1;
+
+	if ((in = fopen(file, "r")) == NULL) {
+		sys_err(" ***error*** file open failure", SOURCE, __LINE__, 0);
+		return -1;
+	}
+
+	if (fseeko(in, -(off_t)(sizeof(f) + sizeof(magic)), SEEK_END)
+	    || fread(f, sizeof(uint64_t), 3, in) != 3
+	    || fread(magic, 1, sizeof(magic), in) != sizeof(magic)
+	    || memcmp(magic, ARC_END, sizeof(magic))) {
+		sys_err(" ***error*** not an archive", SOURCE, __LINE__, 0);
+		goto end;
+	}
+	if (n < 1 || n > f[1]) {
+		sys_err(" ***error*** no such message in the archive", SOURCE, __LINE__, 0);
+		goto end;
+	}
+
+	/* message entry, then its block entry */
+	if (fseeko(in, f[2] + f[0] * (sizeof(boff) + sizeof(b))
+		   + (n - 1) * sizeof(m), SEEK_SET)
+	    || fread(m, sizeof(uint32_t), 3, in) != 3
+	    || m[0] >= f[0]
+	    || fseeko(in, f[2] + m[0] * (sizeof(boff) + sizeof(b)), SEEK_SET)
+	    || fread(&boff, sizeof(boff), 1, in) != 1
+	    || fread(b, sizeof(uint32_t), 2, in) != 2
+	    || (uint64_t)m[1] + m[2] > b[1]) {
+		sys_err(" ***error*** broken archive index", SOURCE, __LINE__, 0);
+		goto end;
+	}
+
+	Emalloc(raw, b[1] + 1);
+	if (fseeko(in, boff, SEEK_SET)) {
+		goto broken;
+	}
+	if (b[0] == 0) {
+		if (fread(raw, 1, b[1], in) != b[1]) {
+			goto broken;
+		}
+	}
+	else {
+#ifdef HAVE_ZLIB
+		uLongf len = b[1];
+
+		Emalloc(comp, b[0]);
+		if (fread(comp, 1, b[0], in) != b[0]
+		    || uncompress((Bytef *)raw, &len, (Bytef *)comp, b[0]) != Z_OK
+		    || len != b[1]) {
+			goto broken;
+		}
+#else
+		sys_err(" ***error*** built without zlib, can not read the block",
+			SOURCE, __LINE__, 0);
+		goto end;
+#endif
+	}
+
+	fwrite(raw + m[1], 1, m[2], o);
+	rc = 0;
+	goto end;
+
+broken:
+	sys_err(" ***error*** broken archive block", SOURCE, __LINE__, 0);
+end:
+	if (raw) {
+		Efree(raw);
+	}
+	if (comp) {
+		Efree(comp);
+	}
+	Fclose(in);
+
+	return rc;
+}
+
+/* end of source */
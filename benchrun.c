@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  benchrun.c
+#contents :  run a command and report its throughput and peak RSS
+#version  :  1.00
+#higher module : Makefile (bench)
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  benchmark runner
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"benchrun.c"
+
+
+/********************************************
+ * main routine
+ ********************************************
+ *
+ * usage: benchrun label input messages command [args]
+ *
+ * the command runs with stdout thrown away. one line is printed
+ * out: label, seconds, MB/s and messages/s of the input, peak RSS.
+ *
+*/
+int main (int argc, char **argv)
+{
+	struct stat st;
+	struct timespec s, e;
+	struct rusage ru;
+	double sec;
+	double mb;
+	unsigned long nmsg;
+	pid_t pid;
+	int status;
+	int fd;
+
+	if (argc < 5) {
+		fprintf(stderr, "usage: benchrun label input messages command [args]\n");
+		exit(1);
+	}
+	if (stat(argv[2], &st)) {
+		sys_err(" ***error*** can not stat the input", SOURCE, __LINE__, 0);
+		exit(1);
+	}
+	mb = st.st_size / (1024.0 * 1024.0);
+	nmsg = strtoul(argv[3], NULL, 10);
+
+	clock_gettime(CLOCK_MONOTONIC, &s);
+	if ((pid = fork()) == 0) {
+		if ((fd = open("/dev/null", O_WRONLY)) >= 0) {
+			dup2(fd, 1);
+		}
+		execvp(argv[4], argv + 4);
+		sys_err(" ***error*** exec failure", SOURCE, __LINE__, 0);
+		_exit(127);
+	}
+	if (pid < 0 || wait4(pid, &status, 0, &ru) < 0) {
+		sys_err(" ***error*** fork/wait failure", SOURCE, __LINE__, 0);
+		exit(1);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &e);
+
+	sec = (e.tv_sec - s.tv_sec) + (e.tv_nsec - s.tv_nsec) / 1e9;
+	if (sec <= 0) {
+		sec = 1e-9;
+	}
+	fprintf(stdout, "%-24s %8.3f s %9.1f MB/s %11.0f msg/s %8ld KB\n",
+		argv[1], sec, mb / sec, nmsg / sec, ru.ru_maxrss);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+/* end of source */
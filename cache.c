@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  cache.c
+#contents :  cache_open(), cache_put(), cache_close(), getcache()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : getlog.c, misc.c, zlib (if HAVE_ZLIB)
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  precompacted binary cache of a log
+#update  :  2026/10/19  check the records against the block
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * file layout
+ *
+ *   header  "MVIEWCAC", u32 version, u32 flags
+ *   block   u32 raw length, u32 compressed length (0: stored), data
+ *   ...
+ *
+ * a block holds whole records only. a record is
+ *
+ *   u8 type, varint length, line
+ *   [ u8 lowered, [ lowered line, '\0' ], varint nfield,
+ *     nfield * { varint start, varint length } ]
+ *
+ * the part in brackets follows only for "src:[", "dst:[" and "date:["
+ * lines. the fields are kept as positions in the lowered line (which
+ * is stored only when it differs from the line or a field is not
+ * closed by ']'), split as getlog() would do. R_FILE records carry the name of the original input
+ * instead of a line.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <sys/stat.h>
+#include "mview.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"cache.c"
+
+#define CACHE_MAGIC	"MVIEWCAC"
+#define CACHE_VERSION	1
+#define CACHE_BLOCK	(1024 * 1024)
+#define CACHE_ZLEVEL	Z_DEFAULT_COMPRESSION
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+enum {
+	R_LINE		= 0,
+	R_FROM		= 1,	/* R_FROM + FROM/TO/DATE */
+	R_TO		= 2,
+	R_DATE		= 3,
+	R_FILE		= 4
+};
+
+enum {
+	F_COMPRESS	= 1
+};
+
+/*
+ * writer
+*/
+static FILE *pcache	= NULL;
+static int zflag	= 0;
+static Buf wblk;	/* records of current block */
+static Buf zblk;	/* compressed block */
+
+/*
+ * reader
+*/
+static Buf rblk;	/* raw block */
+static size_t rpos	= 0;
+static char *rname	= NULL;
+static int rnew		= 0;	/* "rname" not asked by cachename() yet */
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void cache_open(const char *, int);
+void cache_file(const char *);
+void cache_put(const char *, size_t);
+void cache_close(void);
+int iscache(FILE *);
+char *getcache(FILE *);
+char *cachename(void);
+static void flush(void);
+static int fill(FILE *);
+static int varint(const unsigned char **, const unsigned char *, uint64_t *);
+
+
+/********************************************
+ * open cache
+ ********************************************
+*/
+void cache_open (const char *file, int compress)
+{
+	uint32_t h[2];
+
+	Fopen(pcache, file, "w");
+	if (pcache == NULL) {
+		exit(1);
+	}
+#ifdef HAVE_ZLIB
+	zflag = compress;
+#else
+	if (compress) {
+		sys_err(" **warning** built without zlib, cache is not compressed",
+			SOURCE, __LINE__, 0);
+	}
+#endif
+
+	h[0] = CACHE_VERSION;
+	h[1] = zflag ? F_COMPRESS : 0;
+	fwrite(CACHE_MAGIC, 1, strlen(CACHE_MAGIC), pcache);
+	fwrite(h, sizeof(uint32_t), 2, pcache);
+}
+
+/********************************************
+ * flush block
+ ********************************************
+*/
+void flush (void)
+{
+	uint32_t h[2];
+
+	if (wblk.len == 0) {
+		return;
+	}
+
+	h[0] = (uint32_t)wblk.len;
+	h[1] = 0;
+#ifdef HAVE_ZLIB
+	if (zflag) {
+		uLongf n = compressBound(wblk.len);
+
+		if (zblk.size < n) {
+			zblk.size = n;
+			Realloc(zblk.data, zblk.size);
+		}
+		if (compress2((Bytef *)zblk.data, &n, (Bytef *)wblk.data,
+			      wblk.len, CACHE_ZLEVEL) == Z_OK && n < wblk.len) {
+			h[1] = (uint32_t)n;
+		}
+	}
+#endif
+	fwrite(h, sizeof(uint32_t), 2, pcache);
+	if (h[1]) {
+		fwrite(zblk.data, 1, h[1], pcache);
+	}
+	else {
+		fwrite(wblk.data, 1, wblk.len, pcache);
+	}
+	wblk.len = 0;
+}
+
+/********************************************
+ * put name of the input
+ ********************************************
+*/
+void cache_file (const char *name)
+{
+	unsigned char t = R_FILE;
+	size_t n = strlen(name);
+
+	if (pcache == NULL) {
+		return;
+	}
+	bufput(&wblk, &t, 1);
+	bufvarint(&wblk, n);
+	bufput(&wblk, name, n);
+}
+
+/********************************************
+ * put a line returned by getlog()
+ ********************************************
+*/
+void cache_put (const char *p, size_t n)
+{
+	unsigned char t;
+	int type;
+	int nf;
+	char *q;
+	const char *lp;	/* lowered line */
+	int lowered;
+
+	if (pcache == NULL) {
+		return;
+	}
+
+	if (!strncmp(p, STR_SRC, strlen(STR_SRC))) {
+		type = FROM;
+	}
+	else if (!strncmp(p, STR_DST, strlen(STR_DST))) {
+		type = TO;
+	}
+	else if (!strncmp(p, STR_DATE, strlen(STR_DATE))) {
+		type = DATE;
+	}
+	else {
+		type = -1;
+	}
+
+	t = (type < 0) ? R_LINE : R_FROM + type;
+	bufput(&wblk, &t, 1);
+	bufvarint(&wblk, n);
+	bufput(&wblk, p, n);
+
+	if (type >= 0) {
+		lp = getlowered();
+		nf = getnfield(type);
+		lowered = memcmp(p, lp, n) != 0;
+		if (nf > 0) {
+			q = getfield(nf - 1, type);
+			lowered |= (q - lp) + strlen(q) >= n;
+		}
+		t = lowered;
+		bufput(&wblk, &t, 1);
+		if (lowered) {
+			bufput(&wblk, lp, n);
+			bufput(&wblk, "", 1);
+		}
+		bufvarint(&wblk, nf);
+		for (int i = 0; i < nf; i++) {
+			q = getfield(i, type);
+			bufvarint(&wblk, q - lp);
+			bufvarint(&wblk, strlen(q));
+		}
+	}
+
+	if (wblk.len >= CACHE_BLOCK) {
+		flush();
+	}
+}
+
+/********************************************
+ * close cache
+ ********************************************
+*/
+void cache_close (void)
+{
+	if (pcache == NULL) {
+		return;
+	}
+	flush();
+	if (ferror(pcache)) {
+		sys_err(" ***error*** cache write failure", SOURCE, __LINE__, 0);
+	}
+	Fclose(pcache);
+	pcache = NULL;
+
+	buffree(&wblk);
+	buffree(&zblk);
+}
+
+/********************************************
+ * is cache or not
+ ********************************************
+ *
+ * read the header if the input is a cache, otherwise rewind
+ * the input for getlog(). only a regular file is looked at, since
+ * a pipe can not be rewound; it is always read by getlog().
+ *
+*/
+int iscache (FILE *in)
+{
+	char m[sizeof(CACHE_MAGIC) - 1];
+	uint32_t h[2];
+	struct stat sb;
+
+	if (fstat(fileno(in), &sb) != 0 || !S_ISREG(sb.st_mode)) {
+		return 0;
+	}
+	if (fread(m, 1, sizeof(m), in) == sizeof(m)
+	    && !memcmp(m, CACHE_MAGIC, sizeof(m))
+	    && fread(h, sizeof(uint32_t), 2, in) == 2) {
+		if (h[0] != CACHE_VERSION) {
+			sys_err(" ***error*** unknown cache version",
+				SOURCE, __LINE__, 0);
+			exit(1);
+		}
+		rblk.len = rpos = 0;
+		return 1;
+	}
+
+	if (fseeko(in, 0, SEEK_SET) != 0) {
+		sys_err(" **warning** can not rewind the input", SOURCE, __LINE__, 0);
+	}
+	return 0;
+}
+
+/********************************************
+ * fill next block
+ ********************************************
+*/
+int fill (FILE *in)
+{
+	uint32_t h[2];
+
+	if (fread(h, sizeof(uint32_t), 2, in) != 2) {
+		return 0;
+	}
+
+	rblk.len = rpos = 0;
+	if (rblk.size < h[0]) {
+		rblk.size = h[0];
+		Realloc(rblk.data, rblk.size);
+	}
+
+	if (h[1] == 0) {
+		if (fread(rblk.data, 1, h[0], in) != h[0]) {
+			goto broken;
+		}
+	}
+	else {
+#ifdef HAVE_ZLIB
+		uLongf n = h[0];
+
+		if (zblk.size < h[1]) {
+			zblk.size = h[1];
+			Realloc(zblk.data, zblk.size);
+		}
+		if (fread(zblk.data, 1, h[1], in) != h[1]
+		    || uncompress((Bytef *)rblk.data, &n,
+				  (Bytef *)zblk.data, h[1]) != Z_OK
+		    || n != h[0]) {
+			goto broken;
+		}
+#else
+		sys_err(" ***error*** built without zlib, can not read compressed cache",
+			SOURCE, __LINE__, 0);
+		exit(1);
+#endif
+	}
+	rblk.len = h[0];
+
+	return 1;
+
+broken:
+	sys_err(" ***error*** broken cache", SOURCE, __LINE__, 0);
+	exit(1);
+}
+
+/*
+ * varint at "*p", 0 if it runs past "e" or 64 bits
+*/
+int varint (const unsigned char **p, const unsigned char *e, uint64_t *v)
+{
+	const unsigned char *q = *p;
+	int s = 0;
+
+	*v = 0;
+	do {
+		if (q >= e || s > 63) {
+			return 0;
+		}
+		*v |= (uint64_t)(*q & 0x7f) << s;
+		s += 7;
+	} while (*q++ & 0x80);
+	*p = q;
+
+	return 1;
+}
+
+/********************************************
+ * get cache
+ ********************************************
+ *
+ * same as getlog() but the line and its fields come from the
+ * cache instead of tolowerall() and split(). every length and
+ * position is checked against the block, a broken one stops the run.
+ *
+*/
+char *getcache (FILE *in)
+{
+	const unsigned char *p;
+	const unsigned char *e;	/* end of the block */
+	char *line;
+	char *lp;	/* lowered line */
+	int type;
+	int low;	/* lowered line stored */
+	uint64_t n;
+	uint64_t len;
+	uint64_t start;
+	uint64_t nf;
+
+	for (;;) {
+		if (rpos >= rblk.len && !fill(in)) {
+			return NULL;
+		}
+
+		p = (const unsigned char *)rblk.data + rpos;
+		e = (const unsigned char *)rblk.data + rblk.len;
+		type = *p++;
+		if (type > R_FILE || !varint(&p, e, &n) || n > (uint64_t)(e - p)) {
+			goto broken;
+		}
+
+		if (type == R_FILE) {
+			Realloc(rname, n + 1);
+			memcpy(rname, p, n);
+			rname[n] = '\0';
+			rnew = 1;
+			setoffset(0);
+			rpos = (const char *)p + n - rblk.data;
+			continue;
+		}
+
+		line = putlog((const char *)p, n);
+		lp = (char *)p;
+		p += n;
+
+		/*
+		 * the line was copied by putlog(), so the fields are
+		 * terminated in the block itself
+		*/
+		if (type != R_LINE) {
+			if (p >= e) {
+				goto broken;
+			}
+			if ((low = *p++) != 0) {
+				if (n >= (uint64_t)(e - p) || p[n] != '\0') {
+					goto broken;
+				}
+				lp = (char *)p;
+				p += n + 1;
+			}
+
+			/*
+			 * a field ends before the end of the line, or at
+			 * the '\0' of a lowered line
+			*/
+			if (!varint(&p, e, &nf) || nf > (uint64_t)(e - p) / 2) {
+				goto broken;
+			}
+			for (int i = 0; i < (int)nf; i++) {
+				if (!varint(&p, e, &start) || !varint(&p, e, &len)
+				    || start > n || len > n - start
+				    || (!low && start + len == n)) {
+					goto broken;
+				}
+				lp[start + len] = '\0';
+				putfield(i, lp + start);
+			}
+			setnfield((int)nf, type - R_FROM);
+		}
+		rpos = (const char *)p - rblk.data;
+
+		return line;
+	}
+
+broken:
+	sys_err(" ***error*** broken cache", SOURCE, __LINE__, 0);
+	exit(1);
+}
+
+/********************************************
+ * name of the input in the cache
+ ********************************************
+ *
+ * the name of the input the lines come from, when it changed since
+ * the last call, otherwise NULL. it is overwritten by the next one.
+ *
+*/
+char *cachename (void)
+{
+	if (!rnew) {
+		return NULL;
+	}
+	rnew = 0;
+
+	return rname;
+}
+
+/* end of source */
@@ -0,0 +1,626 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  daemon.c
+#contents :  daemon_run(), client_run()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : misc.c, pthread, unix socket
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  query daemon over a unix socket
+#update  :  2026/10/19  read the logs by pread(), not mapped
+#update  :  2026/10/19  free what a query left half done
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * the daemon answers queries on a unix socket, a thread per
+ * connection reads the query and hands it to the scanner of its log.
+ * the logs are read by pread() (they stay in the page cache), not
+ * mapped: a log truncated under a pass (logrotate copytruncate) ends
+ * the pass early instead of killing the daemon by SIGBUS.
+ *
+ * there is one scanner thread per log at most. the queries coming
+ * while it scans wait for the next pass, which takes all of them at
+ * once: each chunk of whole messages is split once and matched for
+ * every query of the pass, and the results are streamed back per
+ * chunk, in the order of the log.
+ *
+ * query, lines of "key value" ended by an empty line
+ *
+ *   file PATH       (absolute)
+ *   sender S / rcpt R / date D
+ *   write           messages written down are sent as well
+ *   count           only the number of matches is sent
+ *
+ * answer
+ *
+ *   M line          a match, without the index
+ *   D length        followed by a message written down
+ *   C count         end
+ *   E message       error, end
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"daemon.c"
+
+#define CHUNK_SIZE	(1024 * 1024)
+#define JOIN_WAIT	2000		/* us, to gather the queries */
+#define MAX_QUERY	256		/* of a pass */
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _log {
+	char *path;
+	Query *pending;		/* for the next pass */
+	int running;		/* a scanner is on it */
+	struct _log *next;
+} Log;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static Log *logs	= NULL;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static void (*serve)(Batch *, Query **, int) = NULL;
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+int daemon_run(const char *, void (*)(Batch *, Query **, int));
+int client_run(const char *, char **, int, Header *, const char *, int);
+static void *conn(void *);
+static void *scanner(void *);
+static void qfree(Query *);
+static size_t chunk(int, Buf *, off_t *, off_t *);
+static int sendall(Query *, const void *, size_t);
+static void answer(Query *);
+static void reply(int, const char *);
+static int connectto(const char *);
+
+
+/********************************************
+ * write all to the client
+ ********************************************
+*/
+int sendall (Query *q, const void *p, size_t n)
+{
+	ssize_t w;
+
+	while (q->fd >= 0 && n > 0) {
+		if ((w = send(q->fd, p, n, MSG_NOSIGNAL)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			close(q->fd);
+			q->fd = -1;		/* gone, not served any more */
+			return -1;
+		}
+		p = (const char *)p + w;
+		n -= w;
+	}
+
+	return q->fd >= 0 ? 0 : -1;
+}
+
+void reply (int fd, const char *msg)
+{
+	char b[256];
+
+	snprintf(b, sizeof(b), "E %s\n", msg);
+	send(fd, b, strlen(b), MSG_NOSIGNAL);
+	close(fd);
+}
+
+/*
+ * results of the chunk served last
+*/
+void answer (Query *q)
+{
+	const unsigned char *p;
+	const unsigned char *e;
+	char h[32];
+	size_t n;
+
+	for (size_t i = 0, e; i < q->res.out.len; i = e + 1) {
+		for (e = i; q->res.out.data[e] != NEWLINE; e++)
+			;
+		q->matches++;
+		if (!q->count) {
+			sendall(q, "M ", 2);
+			sendall(q, q->res.out.data + i, e + 1 - i);
+		}
+	}
+	p = (const unsigned char *)q->res.dump.data;
+	e = p + q->res.dump.len;
+	while (p < e) {
+		n = getvarint(&p);
+		snprintf(h, sizeof(h), "D %lu\n", (unsigned long)n);
+		sendall(q, h, strlen(h));
+		sendall(q, p, n);
+		p += n;
+	}
+	q->res.out.len = q->res.dump.len = 0;
+}
+
+/********************************************
+ * read the next chunk of whole messages
+ ********************************************
+ *
+ * the chunk is cut before the last "src:[" line read, unless it is
+ * the first line (one message is larger than a chunk), the bytes
+ * after it are kept in "in" for the next call. the log is read up to
+ * "size" taken at the start of the pass, less if it was truncated.
+ * returns the length of the chunk, 0 at the end.
+ *
+*/
+size_t chunk (int fd, Buf *in, off_t *pos, off_t *size)
+{
+	size_t len = strlen(STR_SRC);
+	size_t lo = 1;		/* no "src:[" line starts before */
+	size_t want;
+	ssize_t r;
+
+	for (;;) {
+		if (*pos >= *size) {
+			return in->len;
+		}
+		if (in->len >= CHUNK_SIZE && in->len >= len) {
+			for (size_t i = in->len - len; i >= lo; i--) {
+				if (in->data[i - 1] == NEWLINE
+				    && !strncmp(in->data + i, STR_SRC, len)) {
+					return i;
+				}
+			}
+			lo = in->len - len + 1;
+		}
+
+		want = *size - *pos < CHUNK_SIZE ? *size - *pos : CHUNK_SIZE;
+		if (in->size < in->len + want) {
+			in->size = in->len + want;
+			Realloc(in->data, in->size);
+		}
+		if ((r = pread(fd, in->data + in->len, want, *pos)) < 0
+		    && errno == EINTR) {
+			continue;
+		}
+		if (r <= 0) {
+			*size = *pos;		/* truncated, or unreadable */
+			continue;
+		}
+		in->len += r;
+		*pos += r;
+	}
+}
+
+/********************************************
+ * scanner of a log
+ ********************************************
+*/
+void *scanner (void *arg)
+{
+	Log *l = arg;
+	Query *q[MAX_QUERY];
+	Query *t;
+	Batch b;
+	char h[32];
+	size_t cut;
+	size_t len;
+	off_t pos;
+	off_t size;
+	struct stat sb;
+	int fd;
+	int all;	/* queries of the pass */
+	int n;		/* the ones still served */
+	int k;
+
+	memset(&b, 0, sizeof(b));
+	for (;;) {
+		usleep(JOIN_WAIT);
+
+		pthread_mutex_lock(&lock);
+		for (all = 0; l->pending != NULL && all < MAX_QUERY; all++) {
+			q[all] = l->pending;
+			l->pending = q[all]->next;
+		}
+		if (all == 0) {
+			l->running = 0;
+			pthread_mutex_unlock(&lock);
+			break;
+		}
+		pthread_mutex_unlock(&lock);
+
+		n = all;
+		if ((fd = open(l->path, O_RDONLY)) < 0 || fstat(fd, &sb) != 0) {
+			for (k = 0; k < n; k++) {
+				reply(q[k]->fd, "can not read the log");
+				q[k]->fd = -1;
+			}
+			n = 0;
+		}
+
+		/*
+		 * one pass for all, by chunks of whole messages
+		*/
+		b.in.len = 0;
+		b.name = l->path;
+		b.offset = 0;
+		pos = 0;
+		size = n > 0 ? sb.st_size : 0;
+		if (n > 0) {
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+		while (n > 0 && (cut = chunk(fd, &b.in, &pos, &size)) > 0) {
+			len = b.in.len;
+			b.in.len = cut;
+			serve(&b, q, n);
+			memmove(b.in.data, b.in.data + cut, len - cut);
+			b.in.len = len - cut;
+			b.offset += cut;
+
+			/*
+			 * the clients gone are put after the ones served
+			*/
+			for (k = 0; k < n; ) {
+				answer(q[k]);
+				if (q[k]->fd < 0) {
+					t = q[k];
+					q[k] = q[--n];
+					q[n] = t;
+					continue;
+				}
+				k++;
+			}
+		}
+		if (fd >= 0) {
+			close(fd);
+		}
+
+		for (k = 0; k < all; k++) {
+			t = q[k];
+			if (t->fd >= 0) {
+				snprintf(h, sizeof(h), "C %lu\n", t->matches);
+				sendall(t, h, strlen(h));
+				close(t->fd);
+			}
+			qfree(t);
+		}
+	}
+	buffree(&b.in);
+
+	return arg;
+}
+
+/*
+ * free a query
+*/
+void qfree (Query *q)
+{
+	/*
+	 * a message or the lines of a chunk left half done
+	*/
+	if (q->pout != NULL) {
+		Fclose(q->pout);
+	}
+	if (q->line != NULL) {
+		Fclose(q->line);
+	}
+	Efree(q->lbuf);
+	Efree(q->res.mem);
+	rcpt_free(&q->log);
+	Efree(q->log.date);
+	Efree(q->opt.next);
+	Efree(q->opt.date);
+	Efree(q->file);
+	buffree(&q->res.out);
+	buffree(&q->res.dump);
+	Efree(q);
+}
+
+/********************************************
+ * connection
+ ********************************************
+*/
+void *conn (void *arg)
+{
+	int fd = (int)(intptr_t)arg;
+	FILE *in;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	Query *q;
+	Log *l;
+	pthread_t t;
+
+	if ((in = fdopen(dup(fd), "r")) == NULL) {
+		close(fd);
+		return NULL;
+	}
+	Calloc(q, 1, sizeof(Query));
+	Emalloc(q->log.next, sizeof(Addr));
+	q->fd = fd;
+
+	while ((len = getline(&line, &size, in)) > 1) {
+		line[len - 1] = '\0';
+		if (!strncmp(line, "file ", 5)) {
+			Estrdup(q->file, line + 5);
+		}
+		else if (!strncmp(line, "sender ", 7)) {
+			strncpy(q->opt.sender, line + 7, sizeof(q->opt.sender) - 1);
+		}
+		else if (!strncmp(line, "rcpt ", 5)) {
+			Calloc(q->opt.next, 1, sizeof(Addr));
+			strncpy(q->opt.next->address, line + 5,
+				sizeof(q->opt.next->address) - 1);
+		}
+		else if (!strncmp(line, "date ", 5)) {
+			Estrdup(q->opt.date, line + 5);
+		}
+		else if (!strcmp(line, "write")) {
+			q->opt.write = 1;
+		}
+		else if (!strcmp(line, "count")) {
+			q->count = 1;
+		}
+	}
+	Efree(line);
+	fclose(in);
+
+	if (q->file == NULL || *q->file != '/') {
+		reply(fd, "no absolute file name");
+		qfree(q);
+		return NULL;
+	}
+
+	/*
+	 * wait for the next pass over the log
+	*/
+	pthread_mutex_lock(&lock);
+	for (l = logs; l != NULL && strcmp(l->path, q->file); l = l->next)
+		;
+	if (l == NULL) {
+		Calloc(l, 1, sizeof(Log));
+		Estrdup(l->path, q->file);
+		l->next = logs;
+		logs = l;
+	}
+	q->next = l->pending;
+	l->pending = q;
+	if (!l->running) {
+		l->running = 1;
+		if (pthread_create(&t, NULL, scanner, l) == 0) {
+			pthread_detach(t);
+		}
+		else {
+			l->running = 0;
+			sys_err(" ***error*** pthread_create failure", SOURCE, __LINE__, 0);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+
+	return NULL;
+}
+
+/********************************************
+ * run the daemon
+ ********************************************
+ *
+ * "fn" matches a chunk for the queries, it does not return.
+ *
+*/
+int daemon_run (const char *path, void (*fn)(Batch *, Query **, int))
+{
+	struct sockaddr_un sa;
+	pthread_t t;
+	int s;
+	int fd;
+
+	serve = fn;
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path)) {
+		sys_err(" ***error*** socket name too long", SOURCE, __LINE__, 0);
+		return 1;
+	}
+	strcpy(sa.sun_path, path);
+	unlink(path);
+	if ((s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0
+	    || bind(s, (struct sockaddr *)&sa, sizeof(sa)) < 0
+	    || listen(s, 64) < 0) {
+		sys_err(" ***error*** can not listen on the socket", SOURCE, __LINE__, 0);
+		return 1;
+	}
+
+	for (;;) {
+		if ((fd = accept(s, NULL, NULL)) < 0) {
+			if (errno != EINTR) {
+				sys_err(" ***error*** accept failure", SOURCE, __LINE__, 0);
+			}
+			continue;
+		}
+		if (pthread_create(&t, NULL, conn, (void *)(intptr_t)fd) == 0) {
+			pthread_detach(t);
+		}
+		else {
+			close(fd);
+		}
+	}
+
+	return 0;
+}
+
+/********************************************
+ * client
+ ********************************************
+*/
+int connectto (const char *path)
+{
+	struct sockaddr_un sa;
+	int fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/*
+ * ask the daemon on "path" for each file, print out as mview does.
+ * the messages are written down to "prefix" N unless it is NULL.
+*/
+int client_run (const char *path, char **files, int nfile, Header *opt,
+		const char *prefix, int count)
+{
+	char real[PATH_MAX];
+	char name[PATH_MAX];
+	unsigned long idx = 0;
+	unsigned long suffix = 0;
+	unsigned long total = 0;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	size_t n;
+	FILE *io;
+	FILE *out;
+	char *m;
+	int fd;
+	int rc = 0;
+
+	for (int i = 0; i < nfile; i++) {
+		if (realpath(files[i], real) == NULL) {
+			fprintf(stderr, "%s: %s\n", files[i], strerror(errno));
+			rc = 1;
+			continue;
+		}
+		if ((fd = connectto(path)) < 0 || (io = fdopen(fd, "r+")) == NULL) {
+			sys_err(" ***error*** can not connect to the daemon",
+				SOURCE, __LINE__, 0);
+			return 1;
+		}
+
+		fprintf(io, "file %s\n", real);
+		if (*opt->sender != '\0') {
+			fprintf(io, "sender %s\n", opt->sender);
+		}
+		if (opt->next != NULL && *opt->next->address != '\0') {
+			fprintf(io, "rcpt %s\n", opt->next->address);
+		}
+		if (opt->date != NULL) {
+			fprintf(io, "date %s\n", opt->date);
+		}
+		if (prefix != NULL) {
+			fprintf(io, "write\n");
+		}
+		if (count) {
+			fprintf(io, "count\n");
+		}
+		fprintf(io, "\n");
+		fflush(io);
+
+		while ((len = getline(&line, &size, io)) > 0) {
+			if (line[0] == 'M') {
+				fprintf(stdout, "%06lu %s", ++idx, line + 2);
+			}
+			else if (line[0] == 'D') {
+				n = strtoul(line + 2, NULL, 10);
+				Emalloc(m, n + 1);
+				if (fread(m, 1, n, io) != n) {
+					Efree(m);
+					break;
+				}
+				snprintf(name, sizeof(name), "%s%lu", prefix, ++suffix);
+				Fopen(out, name, "w");
+				if (out != NULL) {
+					fwrite(m, 1, n, out);
+					Fclose(out);
+				}
+				Efree(m);
+			}
+			else if (line[0] == 'C') {
+				total += strtoul(line + 2, NULL, 10);
+			}
+			else if (line[0] == 'E') {
+				fprintf(stderr, "%s: %s", files[i], line + 2);
+				rc = 1;
+			}
+		}
+		fclose(io);
+	}
+	Efree(line);
+
+	if (count) {
+		fprintf(stdout, "Count: %lu\n", total);
+	}
+
+	return rc;
+}
+
+/* end of source */
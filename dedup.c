@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  dedup.c
+#contents :  dedup_open(), dedup_seen(), dedup_close()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : getlog.c
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  duplicate message detection across relays
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * a message is fingerprinted by 128 bits over the lowered envelope,
+ * the date and "Size:" (and the body lines if asked).
+ *
+ * the fingerprints seen within "window" seconds of the latest date
+ * are kept exactly in an open addressing table, in order of arrival
+ * in a ring as well. when the ring is full or the head gets older
+ * than the window, the head moves out of the table into a bloom
+ * filter of fixed size, which answers for the long tail with a
+ * small chance of false positive.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"dedup.c"
+
+#define BLOOM_K		7
+#define MAX_RECENT	(1 << 18)	/* fingerprints kept exactly */
+#define ROTL(x, r)	(((x) << (r)) | ((x) >> (64 - (r))))
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _fp {
+	uint64_t h1;
+	uint64_t h2;
+	int64_t epoch;
+} Fp;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static long window	= 0;	/* seconds */
+static int body		= 0;	/* hash the body too */
+
+static Fp *ring		= NULL;	/* recent fingerprints, oldest first */
+static size_t rhead	= 0;
+static size_t rlen	= 0;
+
+static Fp *table	= NULL;	/* the same as "ring", h1 == 0 is empty */
+static size_t tmask	= 0;
+
+static unsigned char *bloom = NULL;
+static uint64_t nbit	= 0;
+
+static int64_t latest	= 0;
+static unsigned long ndup = 0;
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void dedup_open(long, size_t, int);
+int dedup_seen(Msg *);
+unsigned long dedup_close(void);
+static uint64_t fmix(uint64_t);
+static void mix(uint64_t *, uint64_t *, const char *, size_t, int);
+static size_t lookup(Fp *);
+static void delete(size_t);
+static void evict(void);
+static int inbloom(Fp *, int);
+
+
+/********************************************
+ * finalizer of murmur3
+ ********************************************
+*/
+uint64_t fmix (uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+
+	return k;
+}
+
+/********************************************
+ * mix a line into the fingerprint
+ ********************************************
+*/
+void mix (uint64_t *h1, uint64_t *h2, const char *p, size_t n, int lower)
+{
+	uint64_t a = *h1;
+	uint64_t b = *h2;
+	unsigned char c;
+
+	for (size_t i = 0; i < n; i++) {
+		c = lower ? tolower((unsigned char)p[i]) : (unsigned char)p[i];
+		a = (a ^ c) * 0x100000001b3ULL;
+		b = ROTL(b ^ c, 23) * 0x9e3779b97f4a7c15ULL;
+	}
+	*h1 = (a ^ NEWLINE) * 0x100000001b3ULL;
+	*h2 = ROTL(b ^ NEWLINE, 23) * 0x9e3779b97f4a7c15ULL;
+}
+
+/********************************************
+ * open dedup
+ ********************************************
+*/
+void dedup_open (long sec, size_t mem, int withbody)
+{
+	window = sec;
+	body = withbody;
+
+	Calloc(ring, MAX_RECENT, sizeof(Fp));
+	Calloc(table, MAX_RECENT * 2, sizeof(Fp));
+	tmask = MAX_RECENT * 2 - 1;
+
+	nbit = (uint64_t)(mem > 0 ? mem : 1) * 8;
+	Calloc(bloom, nbit / 8, 1);
+}
+
+/********************************************
+ * lookup table
+ ********************************************
+ *
+ * returns the slot of the fingerprint or the empty slot
+ * where it would be put.
+ *
+*/
+size_t lookup (Fp *f)
+{
+	size_t i;
+
+	for (i = f->h1 & tmask; table[i].h1 != 0; i = (i + 1) & tmask) {
+		if (table[i].h1 == f->h1 && table[i].h2 == f->h2) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/********************************************
+ * delete from table (backward shift)
+ ********************************************
+*/
+void delete (size_t i)
+{
+	size_t j, k;
+
+	for (j = i; ; ) {
+		j = (j + 1) & tmask;
+		if (table[j].h1 == 0) {
+			break;
+		}
+		k = table[j].h1 & tmask;
+		/* move j to i unless its home lies cyclically in (i, j] */
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j)) {
+			continue;
+		}
+		table[i] = table[j];
+		i = j;
+	}
+	table[i].h1 = 0;
+}
+
+/********************************************
+ * test/set bloom filter
+ ********************************************
+*/
+int inbloom (Fp *f, int set)
+{
+	uint64_t b;
+	int hit = 1;
+
+	for (int i = 0; i < BLOOM_K; i++) {
+		b = (f->h1 + i * f->h2) % nbit;
+		if (!(bloom[b >> 3] & (1 << (b & 7)))) {
+			hit = 0;
+			if (!set) {
+				break;
+			}
+			bloom[b >> 3] |= 1 << (b & 7);
+		}
+	}
+
+	return hit;
+}
+
+/********************************************
+ * move old fingerprints to bloom filter
+ ********************************************
+*/
+void evict (void)
+{
+	Fp *f;
+
+	while (rlen > 0) {
+		f = &ring[rhead];
+		if (rlen < MAX_RECENT && f->epoch >= latest - window) {
+			break;
+		}
+		delete(lookup(f));
+		inbloom(f, 1);
+		rhead = (rhead + 1) % MAX_RECENT;
+		rlen--;
+	}
+}
+
+/********************************************
+ * seen or not
+ ********************************************
+ *
+ * returns 1 if the message is a duplicate of a former one,
+ * otherwise remembers it and returns 0.
+ *
+*/
+int dedup_seen (Msg *m)
+{
+	Fp f;
+	size_t i;
+	const char *p = m->text.data;
+	const char *e = p + m->text.len;
+	const char *q;
+	uint64_t b1 = 0, b2 = 0;
+	int64_t t;
+
+	f.h1 = 0xcbf29ce484222325ULL;
+	f.h2 = 0x84222325cbf29ce4ULL;
+	for (; p < e; p = q + 1) {
+		q = memchr(p, NEWLINE, e - p);
+		if (!strncmp(p, STR_SRC, strlen(STR_SRC))
+		    || !strncmp(p, STR_DST, strlen(STR_DST))
+		    || !strncmp(p, STR_DATE, strlen(STR_DATE))
+		    || !strncmp(p, STR_SIZE, strlen(STR_SIZE))) {
+			mix(&f.h1, &f.h2, p, q - p, 1);
+		}
+		else if (body) {
+			mix(&b1, &b2, p, q - p, 0);
+		}
+	}
+	f.h1 = fmix(f.h1 ^ b1);
+	f.h2 = fmix(f.h2 ^ ROTL(b2, 31));
+	if (f.h1 == 0) {
+		f.h1 = 1;	/* 0 is the empty slot */
+	}
+
+	t = getepoch(m->date);
+	if (t > latest) {
+		latest = t;
+	}
+	f.epoch = t;
+
+	i = lookup(&f);
+	if (table[i].h1 != 0 || inbloom(&f, 0)) {
+		ndup++;
+		return 1;
+	}
+
+	if (rlen == MAX_RECENT) {
+		evict();
+		i = lookup(&f);
+	}
+	table[i] = f;
+	ring[(rhead + rlen) % MAX_RECENT] = f;
+	rlen++;
+	evict();
+
+	return 0;
+}
+
+/********************************************
+ * close dedup
+ ********************************************
+*/
+unsigned long dedup_close (void)
+{
+	if (ring) {
+		Efree(ring);
+	}
+	if (table) {
+		Efree(table);
+	}
+	if (bloom) {
+		Efree(bloom);
+	}
+	ring = table = NULL;
+	bloom = NULL;
+	rhead = rlen = 0;
+
+	return ndup;
+}
+
+/* end of source */
@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  export.c
+#contents :  exp_open(), exp_put(), exp_close()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : misc.c
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  columnar binary export of envelopes
+#update  :  2026/10/19  reader for the test, "make expdump"
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * file layout (host byte order, little-endian expected)
+ *
+ *   header     "MVIEWCOL", u32 version, u32 ncolumn,
+ *              u64 nrow, u64 nrcpt, u32 ndict, u32 byte order mark
+ *   directory  ncolumn * { u32 id, u32 encoding, u64 offset, u64 length }
+ *   columns    each one starts on an 8 bytes boundary
+ *
+ *   COL_OFFSET  DELTA  offset of "src:[" line, restarts when COL_FILE changes
+ *   COL_DATE    DELTA  "date:[" as seconds since the epoch
+ *   COL_SIZE    U64    value of "Size:"
+ *   COL_FILE    U32    input file name (dictionary id)
+ *   COL_SENDER  U32    sender address (dictionary id)
+ *   COL_RINDEX  U64    nrow + 1 entries, row i owns rcpt[rindex[i], rindex[i+1])
+ *   COL_RCPT    U32    receiver addresses (dictionary id)
+ *   COL_DICT    DICT   u32 offset[ndict + 1], then NUL terminated strings
+ *
+ * DELTA is a zigzag encoded LEB128 difference from the previous row,
+ * so it must be scanned from the top. the other columns are fixed
+ * width and can be addressed directly after mmap().
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"export.c"
+
+#define EXP_MAGIC	"MVIEWCOL"
+#define EXP_VERSION	1
+#define EXP_BOM		0x01020304
+#define EXP_ALIGN	8
+
+#define ZIGZAG(v)	(((uint64_t)(v) << 1) ^ (uint64_t)((int64_t)(v) >> 63))
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+enum {
+	COL_OFFSET	= 0,
+	COL_DATE	= 1,
+	COL_SIZE	= 2,
+	COL_FILE	= 3,
+	COL_SENDER	= 4,
+	COL_RINDEX	= 5,
+	COL_RCPT	= 6,
+	COL_DICT	= 7,
+	NCOLUMN		= 8
+};
+
+enum {
+	ENC_U32		= 1,
+	ENC_U64		= 2,
+	ENC_DELTA	= 3,
+	ENC_DICT	= 4
+};
+
+static const uint32_t encoding[NCOLUMN] = {
+	ENC_DELTA, ENC_DELTA, ENC_U64, ENC_U32,
+	ENC_U32, ENC_U64, ENC_U32, ENC_DICT
+};
+
+static FILE *pexp	= NULL;		/* export file */
+static Buf col[NCOLUMN];		/* column data */
+static uint64_t nrow	= 0;
+static uint64_t nrcpt	= 0;
+static int64_t last_off	= 0;
+static int64_t last_date= 0;
+static int64_t last_file = -1;	/* offset of its name in "dstr" */
+static uint32_t last_fid = 0;
+
+/*
+ * dictionary: strings in "dstr", their offset in "doff",
+ * hash table "dtab" holds id + 1 (0 is empty)
+*/
+static Buf dstr;
+static Buf doff;
+static uint32_t *dtab	= NULL;
+static uint32_t dcap	= 0;
+static uint32_t ndict	= 0;
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void exp_open(const char *);
+void exp_put(const char *, Header *);
+void exp_close(void);
+static uint32_t intern(const char *);
+static void rehash(void);
+
+
+/********************************************
+ * rehash dictionary
+ ********************************************
+*/
+void rehash (void)
+{
+	uint32_t *old = dtab;
+	uint32_t ocap = dcap;
+	uint32_t off;
+	const char *p;
+	uint64_t h;
+
+	dcap = dcap ? dcap * 2 : 1024;
+	Calloc(dtab, dcap, sizeof(uint32_t));
+
+	for (uint32_t i = 0; i < ocap; i++) {
+		if (old[i] == 0) {
+			continue;
+		}
+		memcpy(&off, doff.data + (old[i] - 1) * sizeof(uint32_t),
+			sizeof(uint32_t));
+		p = dstr.data + off;
+		h = strhash(p, strlen(p));
+		for (uint32_t j = h & (dcap - 1); ; j = (j + 1) & (dcap - 1)) {
+			if (dtab[j] == 0) {
+				dtab[j] = old[i];
+				break;
+			}
+		}
+	}
+	if (old) {
+		Efree(old);
+	}
+}
+
+/********************************************
+ * intern string into dictionary
+ ********************************************
+*/
+uint32_t intern (const char *p)
+{
+	size_t n = strlen(p);
+	uint64_t h = strhash(p, n);
+	uint32_t off;
+
+	if ((ndict + 1) * 2 > dcap) {
+		rehash();
+	}
+
+	for (uint32_t j = h & (dcap - 1); ; j = (j + 1) & (dcap - 1)) {
+		if (dtab[j] == 0) {
+			off = (uint32_t)dstr.len;
+			bufput(&doff, &off, sizeof(off));
+			bufput(&dstr, p, n + 1);
+			dtab[j] = ++ndict;
+			return ndict - 1;
+		}
+		memcpy(&off, doff.data + (dtab[j] - 1) * sizeof(uint32_t),
+			sizeof(uint32_t));
+		if (!strcmp(dstr.data + off, p)) {
+			return dtab[j] - 1;
+		}
+	}
+}
+
+/********************************************
+ * open export
+ ********************************************
+*/
+void exp_open (const char *file)
+{
+	uint64_t zero = 0;
+
+	Fopen(pexp, file, "w");
+	if (pexp == NULL) {
+		exit(1);
+	}
+	bufput(&col[COL_RINDEX], &zero, sizeof(zero));
+}
+
+/********************************************
+ * put an envelope
+ ********************************************
+*/
+void exp_put (const char *file, Header *p)
+{
+	Rcpt r;		/* receivers read back */
+	const char *s;	/* receiver address */
+	int64_t v;
+	uint32_t id;
+	uint32_t u32;
+	uint64_t u;
+
+	if (pexp == NULL) {
+		return;
+	}
+
+	/*
+	 * the name may be freed and its memory given to the next one,
+	 * so it is compared by the contents
+	*/
+	if (last_file < 0 || strcmp(file, dstr.data + last_file)) {
+		last_fid = intern(file);
+		memcpy(&u32, doff.data + last_fid * sizeof(uint32_t),
+		       sizeof(uint32_t));
+		last_file = u32;
+		last_off = 0;
+	}
+	bufput(&col[COL_FILE], &last_fid, sizeof(last_fid));
+
+	v = (int64_t)p->offset;
+	bufvarint(&col[COL_OFFSET], ZIGZAG(v - last_off));
+	last_off = v;
+
+	v = (int64_t)(p->date ? getepoch(p->date) : -1);
+	bufvarint(&col[COL_DATE], ZIGZAG(v - last_date));
+	last_date = v;
+
+	u = p->size;
+	bufput(&col[COL_SIZE], &u, sizeof(u));
+
+	id = intern(p->sender);
+	bufput(&col[COL_SENDER], &id, sizeof(id));
+
+	for (s = rcpt_first(p, &r); s != NULL; s = rcpt_next(&r), nrcpt++) {
+		id = intern(s);
+		bufput(&col[COL_RCPT], &id, sizeof(id));
+	}
+	bufput(&col[COL_RINDEX], &nrcpt, sizeof(nrcpt));
+
+	nrow++;
+}
+
+/********************************************
+ * close export
+ ********************************************
+ *
+ * the columns are buffered in memory during the pass and
+ * written down at once here.
+ *
+*/
+void exp_close (void)
+{
+	uint32_t h32[4];
+	uint64_t h64[2];
+	uint64_t off;
+	uint32_t end;
+	static const char pad[EXP_ALIGN];
+
+	if (pexp == NULL) {
+		return;
+	}
+
+	/* dictionary column: offset table and strings */
+	end = (uint32_t)dstr.len;
+	bufput(&doff, &end, sizeof(end));
+	bufput(&col[COL_DICT], doff.data, doff.len);
+	bufput(&col[COL_DICT], dstr.data, dstr.len);
+
+	/* header */
+	fwrite(EXP_MAGIC, 1, strlen(EXP_MAGIC), pexp);
+	h32[0] = EXP_VERSION;
+	h32[1] = NCOLUMN;
+	fwrite(h32, sizeof(uint32_t), 2, pexp);
+	h64[0] = nrow;
+	h64[1] = nrcpt;
+	fwrite(h64, sizeof(uint64_t), 2, pexp);
+	h32[0] = ndict;
+	h32[1] = EXP_BOM;
+	fwrite(h32, sizeof(uint32_t), 2, pexp);
+
+	/* directory */
+	off = strlen(EXP_MAGIC) + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t)
+		+ 2 * sizeof(uint32_t) + NCOLUMN * (2 * sizeof(uint32_t)
+		+ 2 * sizeof(uint64_t));
+	for (int i = 0; i < NCOLUMN; i++) {
+		off = (off + EXP_ALIGN - 1) & ~(uint64_t)(EXP_ALIGN - 1);
+		h32[0] = i;
+		h32[1] = encoding[i];
+		h64[0] = off;
+		h64[1] = col[i].len;
+		fwrite(h32, sizeof(uint32_t), 2, pexp);
+		fwrite(h64, sizeof(uint64_t), 2, pexp);
+		off += col[i].len;
+	}
+
+	/* columns */
+	for (int i = 0; i < NCOLUMN; i++) {
+		off = ftello(pexp);
+		fwrite(pad, 1, (EXP_ALIGN - off % EXP_ALIGN) % EXP_ALIGN, pexp);
+		if (col[i].len) {
+			fwrite(col[i].data, 1, col[i].len, pexp);
+		}
+		buffree(&col[i]);
+	}
+
+	if (ferror(pexp)) {
+		sys_err(" ***error*** export write failure", SOURCE, __LINE__, 0);
+	}
+	Fclose(pexp);
+	pexp = NULL;
+
+	buffree(&dstr);
+	buffree(&doff);
+	if (dtab) {
+		Efree(dtab);
+	}
+	dtab = NULL;
+	dcap = ndict = 0;
+}
+
+
+/********************************************
+ * debug section
+ ********************************************
+ *
+ * following code reads an export back, checks its header, directory
+ * and dictionary, and prints out the rows as mview prints the
+ * matched envelopes. do "make expdump" to build it.
+ *
+*/
+#ifdef DEBUG_EXPORT
+
+#define BAD(msg) { \
+	sys_err(" ***error*** " msg, SOURCE, __LINE__, 0); \
+	exit(1); \
+}
+
+int main (int argc, char **argv)
+{
+	FILE *in;
+	unsigned char *m;		/* whole export */
+	const unsigned char *c[NCOLUMN];/* columns */
+	const unsigned char *po, *pd;	/* DELTA columns */
+	uint64_t len[NCOLUMN];
+	uint32_t h32[4];
+	uint64_t h64[2];
+	uint64_t size, prev, v;
+	uint32_t nd, id, u32;
+	const uint32_t *dict;
+	const char *str;
+	int64_t off = 0, date = 0;
+	uint32_t fid = UINT32_MAX;
+	time_t t;
+	struct tm tm;
+	char buf[32];
+	size_t head;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: expdump export\n");
+		exit(1);
+	}
+	Fopen(in, argv[1], "r");
+	if (in == NULL) {
+		exit(1);
+	}
+	fseeko(in, 0, SEEK_END);
+	size = ftello(in);
+	rewind(in);
+	Emalloc(m, size + 1);
+	if (fread(m, 1, size, in) != size) {
+		BAD("export read failure");
+	}
+	Fclose(in);
+
+	/* header */
+	head = strlen(EXP_MAGIC) + 4 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+	if (size < head || memcmp(m, EXP_MAGIC, strlen(EXP_MAGIC))) {
+		BAD("not an export");
+	}
+	memcpy(h32, m + strlen(EXP_MAGIC), 2 * sizeof(uint32_t));
+	memcpy(h64, m + strlen(EXP_MAGIC) + 8, 2 * sizeof(uint64_t));
+	memcpy(h32 + 2, m + strlen(EXP_MAGIC) + 24, 2 * sizeof(uint32_t));
+	if (h32[0] != EXP_VERSION || h32[1] != NCOLUMN || h32[3] != EXP_BOM) {
+		BAD("unknown version, columns or byte order");
+	}
+	nrow = h64[0];
+	nrcpt = h64[1];
+	nd = h32[2];
+
+	/* directory */
+	prev = head + NCOLUMN * (2 * sizeof(uint32_t) + 2 * sizeof(uint64_t));
+	for (int i = 0; i < NCOLUMN; i++) {
+		memcpy(h32, m + head + i * 24, 2 * sizeof(uint32_t));
+		memcpy(h64, m + head + i * 24 + 8, 2 * sizeof(uint64_t));
+		if (h32[0] != (uint32_t)i || h32[1] != encoding[i]
+		    || h64[0] % EXP_ALIGN || h64[0] < prev
+		    || h64[0] + h64[1] > size) {
+			BAD("bad directory");
+		}
+		c[i] = m + h64[0];
+		len[i] = h64[1];
+		prev = h64[0] + h64[1];
+	}
+	if (len[COL_SIZE] != nrow * 8 || len[COL_FILE] != nrow * 4
+	    || len[COL_SENDER] != nrow * 4 || len[COL_RINDEX] != (nrow + 1) * 8
+	    || len[COL_RCPT] != nrcpt * 4) {
+		BAD("bad column length");
+	}
+
+	/* dictionary: the offsets go up and each string ends at the next */
+	dict = (const uint32_t *)c[COL_DICT];
+	str = (const char *)(dict + nd + 1);
+	if (len[COL_DICT] < (nd + 1) * sizeof(uint32_t)
+	    || dict[nd] != len[COL_DICT] - (nd + 1) * sizeof(uint32_t)) {
+		BAD("bad dictionary");
+	}
+	for (uint32_t i = 0; i < nd; i++) {
+		if (dict[i] >= dict[i + 1] || str[dict[i + 1] - 1] != '\0'
+		    || strlen(str + dict[i]) != dict[i + 1] - dict[i] - 1) {
+			BAD("bad dictionary");
+		}
+	}
+
+	/* rows */
+	po = c[COL_OFFSET];
+	pd = c[COL_DATE];
+	in = NULL;
+	for (uint64_t r = 0; r < nrow; r++) {
+		uint64_t rb, re;
+
+		memcpy(&u32, c[COL_FILE] + r * 4, 4);
+		if (u32 >= nd) {
+			BAD("bad file id");
+		}
+		if (u32 != fid) {
+			fid = u32;
+			off = 0;
+			if (in) {
+				Fclose(in);
+			}
+			Fopen(in, str + dict[fid], "r");
+			if (in == NULL) {
+				exit(1);
+			}
+		}
+		v = getvarint(&po);
+		off += (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+		v = getvarint(&pd);
+		date += (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+
+		/* the offset is the one of "src:[" in the input */
+		if (fseeko(in, off, SEEK_SET) || fgets(buf, sizeof(buf), in) == NULL
+		    || strncmp(buf, STR_SRC, strlen(STR_SRC))) {
+			BAD("offset is not at src:[");
+		}
+
+		memcpy(&id, c[COL_SENDER] + r * 4, 4);
+		if (id >= nd) {
+			BAD("bad sender id");
+		}
+		fprintf(stdout, "%06lu %s ", (unsigned long)r + 1, str + dict[id]);
+
+		memcpy(&rb, c[COL_RINDEX] + r * 8, 8);
+		memcpy(&re, c[COL_RINDEX] + (r + 1) * 8, 8);
+		if (rb > re || re > nrcpt) {
+			BAD("bad receiver index");
+		}
+		for (uint64_t i = rb; i < re; i++) {
+			memcpy(&id, c[COL_RCPT] + i * 4, 4);
+			if (id >= nd) {
+				BAD("bad receiver id");
+			}
+			fprintf(stdout, "%s ", str + dict[id]);
+		}
+
+		t = (time_t)date;
+		gmtime_r(&t, &tm);
+		strftime(buf, sizeof(buf), "%Y%m%d%H%M%S", &tm);
+		fprintf(stdout, "%s\n", buf);
+	}
+	if (po != c[COL_OFFSET] + len[COL_OFFSET]
+	    || pd != c[COL_DATE] + len[COL_DATE]) {
+		BAD("bad delta column length");
+	}
+	if (in) {
+		Fclose(in);
+	}
+	Efree(m);
+
+	exit(0);
+}
+
+#endif
+
+/* end of source */
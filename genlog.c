@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  genlog.c
+#contents :  synthetic log generator for the test suite and benchmark
+#version  :  1.00
+#higher module : Makefile (test, bench)
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  deterministic synthetic log generator
+#update  :  2026/10/19  one bulk mail by -B
+#update  :  2026/10/19  usage by -h
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <getopt.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"genlog.c"
+
+#define START_TIME	1293840000L	/* 2011/01/01 00:00:00 */
+#define BODY_WIDTH	72
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static uint64_t seed	= 88172645463325252ULL;
+
+static const char *tld[] = {"com", "net", "org", "jp", "ru", "cn"};
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+static void print_usage(void);
+static uint64_t rnd(void);
+static void address(FILE *, unsigned long, int);
+
+
+/********************************************
+ * print usage
+ ********************************************
+*/
+void print_usage (void)
+{
+	fprintf(stderr,
+		"usage: genlog [-h] [-U] [-n messages] [-f fan-out] [-b body-bytes] [-c cardinality] [-s seed]\n"
+		"              [-B bulk-receivers]\n");
+	fprintf(stderr,
+		"        -h  print out this usage\n");
+	fprintf(stderr,
+		"        -n  number of messages (10000)\n");
+	fprintf(stderr,
+		"        -f  max receivers of a message, 1..f uniformly (4)\n");
+	fprintf(stderr,
+		"        -b  mean body bytes of a message (1024)\n");
+	fprintf(stderr,
+		"        -c  number of distinct addresses (10000)\n");
+	fprintf(stderr,
+		"        -s  seed of the random numbers\n");
+	fprintf(stderr,
+		"        -B  receivers of one bulk mail in the middle (none)\n");
+	fprintf(stderr,
+		"        -U  upper the addresses (same fields after lowering)\n");
+
+	exit(1);
+}
+
+/********************************************
+ * random number (xorshift64*)
+ ********************************************
+*/
+uint64_t rnd (void)
+{
+	seed ^= seed >> 12;
+	seed ^= seed << 25;
+	seed ^= seed >> 27;
+
+	return seed * 2685821657736338717ULL;
+}
+
+/********************************************
+ * print out address
+ ********************************************
+*/
+void address (FILE *o, unsigned long n, int upper)
+{
+	fprintf(o, upper ? "USER%lu@MX%lu.EXAMPLE.%s" : "user%lu@mx%lu.example.%s",
+		n, n % 97, tld[n % (sizeof(tld) / sizeof(tld[0]))]);
+}
+
+/********************************************
+ * main routine
+ ********************************************
+*/
+int main (int argc, char **argv)
+{
+	int ch;
+	unsigned long nmsg = 10000;
+	unsigned long fanout = 4;
+	unsigned long body = 1024;
+	unsigned long card = 10000;
+	unsigned long bulk = 0;
+	int upper = 0;
+	time_t t = START_TIME;
+	struct tm tm;
+	unsigned long n, size, w;
+	char line[BODY_WIDTH + 1];
+
+	while ((ch = getopt(argc, argv, "B:Ub:c:f:hn:s:")) != -1) {
+		switch (ch) {
+		case 'B':
+			bulk = strtoul(optarg, NULL, 10);
+			break;
+		case 'U':
+			upper = 1;
+			break;
+		case 'b':
+			body = strtoul(optarg, NULL, 10);
+			break;
+		case 'c':
+			card = strtoul(optarg, NULL, 10);
+			break;
+		case 'f':
+			fanout = strtoul(optarg, NULL, 10);
+			break;
+		case 'n':
+			nmsg = strtoul(optarg, NULL, 10);
+			break;
+		case 's':
+			seed ^= strtoull(optarg, NULL, 10) * 0x9e3779b97f4a7c15ULL;
+			break;
+		case 'h':
+		default:
+			print_usage();
+			break;
+		}
+	}
+	if (fanout < 1 || card < 1 || seed == 0) {
+		print_usage();
+	}
+
+	for (unsigned long i = 0; i < nmsg; i++) {
+		/* envelope, 1 of 50 has null sender */
+		fprintf(stdout, "src:[");
+		if (rnd() % 50) {
+			address(stdout, rnd() % card, upper);
+		}
+		fprintf(stdout, "]\ndst:[");
+		n = 1 + rnd() % fanout;
+		if (bulk && i == nmsg / 2) {
+			n = bulk;
+		}
+		for (unsigned long j = 0; j < n; j++) {
+			if (j) {
+				fputc(SPACE, stdout);
+			}
+			address(stdout, rnd() % card, upper);
+		}
+		t += rnd() % 4;
+		gmtime_r(&t, &tm);
+		fprintf(stdout, "]\ndate:[%04d%02d%02d%02d%02d%02d]\n",
+			tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+			tm.tm_hour, tm.tm_min, tm.tm_sec);
+
+		/* body of body/2 .. body*3/2 bytes */
+		size = body ? body / 2 + rnd() % (body + 1) : 0;
+		fprintf(stdout, "Subject: message %lu\n", i);
+		for (unsigned long b = 0; b < size; b += w + 1) {
+			w = size - b > BODY_WIDTH ? BODY_WIDTH : size - b;
+			for (unsigned long k = 0; k < w; k++) {
+				line[k] = 'a' + rnd() % 26;
+			}
+			line[w] = '\0';
+			fprintf(stdout, "%s\n", line);
+		}
+		fprintf(stdout, "Size: %lu\n", size);
+	}
+
+	return 0;
+}
+
+/* end of source */
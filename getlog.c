@@ -42,6 +42,8 @@
 ###############################################################################
 #maintenance history
 #create  :  2005/02/24  Tsuyoshi SAKAMOTO  create this program
+#update  :  2026/10/19  split in one pass, give back long line buffers
+#update  :  2026/10/19  stream the receivers of a long "dst:[" line
 #update  :  yyyy/mm/dd  - author -         - comments -
 ###############################################################################
 */
@@ -58,19 +60,38 @@
 */
 #define SOURCE		"getlog.c"
 
+#define LINE_KEEP	65536	/* line buffers kept after a longer line */
+#define FIELD_KEEP	1024	/* fields kept after more of them */
+#define STREAM_AT	LINE_KEEP	/* a longer "dst:[" line is streamed */
+
+#define T_HEAD		-2	/* the prefix is not read yet */
+#define T_NONE		-1	/* not an envelope line */
+
 
 /********************************************
  * global variable
  ********************************************
 */
-static char *log	= NULL;
-static char *slog	= NULL;
-static char **field	= NULL;
-static int f_nfield	= 0;
-static int t_nfield	= 0;
-static int d_nfield	= 0;
-static size_t lsize	= 1;
-static size_t fsize	= sizeof(field);
+/* one line per thread, see pipe.c */
+static THREAD char *log	= NULL;
+static THREAD char *slog	= NULL;
+static THREAD char **field	= NULL;
+static THREAD int f_nfield	= 0;
+static THREAD int t_nfield	= 0;
+static THREAD int d_nfield	= 0;
+static THREAD size_t lsize	= 1;
+static THREAD size_t fsize	= sizeof(field);
+static THREAD int dosplit	= 1;	/* lower and split the lines */
+static THREAD off_t loff	= 0;	/* offset of the line returned last */
+static THREAD off_t noff	= 0;	/* offset of the next line */
+static THREAD size_t llen	= 0;	/* length of the line returned last */
+static THREAD int ttype		= T_NONE;	/* FROM, TO, DATE of the line */
+static THREAD int tin		= 0;	/* in the brackets */
+static THREAD size_t tbeg	= 0;	/* where the field starts in "slog" */
+static THREAD int tn		= 0;	/* number of fields so far */
+static THREAD void (*sink)(const char *, int) = NULL;	/* of streamed fields */
+static THREAD int nstream	= 0;	/* fields of the line streamed */
+static THREAD size_t ndrop	= 0;	/* bytes of the line dropped */
 
 /********************************************
  * prototype
@@ -80,84 +101,217 @@ int getnfield(int);
 void setnfield(int , int);
 char *getfield(int , int);
 char *getlog(FILE *);
-static char *tolowerall(char *);
-static void split(char *);
+char *putlog(const char *, size_t);
+char *setlog(const char *, size_t);
+void putfield(int, char *);
+size_t getlength(void);
+char *getlowered(void);
+off_t getoffset(void);
+off_t getnext(void);
+void setoffset(off_t);
+void setsplit(int);
+void setsink(void (*)(const char *, int));
+int getnstream(void);
+time_t getepoch(const char *);
+static void grow(size_t);
+static void shrink(void);
+static void addfield(size_t);
+static void tokbegin(void);
+static void tok(size_t, int);
+static void tokend(size_t);
+static void tokline(size_t);
+static size_t stream(FILE *, size_t, int *);
 
 
 /********************************************
- * split
+ * line buffers
  ********************************************
 */
-void split(char *p)
+/*
+ * "log" and "slog" hold "n" bytes at least
+*/
+void grow (size_t n)
 {
-	int n;		/* number of field */
-	int type;	/* type of envelope header */
-	char *q;	/* starting pointer of each fields */
-	char **r;	/* work field */
+	if (log == NULL || n > lsize) {
+		while (n > lsize) {
+			lsize *= 2;
+		}
+		Realloc(log, lsize);
+		Realloc(slog, lsize);
+		ST_ADD(grow_line, 1);
+		if (lsize > st.line_size) {
+			ST_ADD(line_size, lsize - st.line_size);
+		}
+	}
+}
 
+/*
+ * the buffers grown by a long line (a bulk mail with many
+ * receivers) are given back once a shorter one follows
+*/
+void shrink (void)
+{
+	if (lsize > LINE_KEEP && llen < LINE_KEEP) {
+		lsize = LINE_KEEP;
+		Realloc(log, lsize);
+		Realloc(slog, lsize);
+		ST_ADD(shrink, 1);
+	}
+	if (fsize > FIELD_KEEP * sizeof(*field) && f_nfield < FIELD_KEEP
+	    && t_nfield < FIELD_KEEP && d_nfield < FIELD_KEEP) {
+		fsize = FIELD_KEEP * sizeof(*field);
+		Realloc(field, fsize);
+		ST_ADD(shrink, 1);
+	}
+}
+
+/********************************************
+ * split
+ ********************************************
+ *
+ * the envelope lines ("src:[", "dst:[", "date:[") are split in one
+ * pass, a byte at a time: "slog" gets the lowered byte, a field ends
+ * at SPACE and the last one at ']'. other lines are left alone after
+ * their first bytes. a long "dst:[" line is split while it is read,
+ * see stream().
+ *
+*/
+void addfield (size_t off)
+{
 	if (field == NULL) {
 		fsize *= 2;
 		Emalloc(field, fsize);
 	}
-
-	if (!strncmp(p, STR_SRC, strlen(STR_SRC))) {
-		p += (STR_SRC_LENGTH - 1);
-		type = FROM;
-	}
-	else if (!strncmp(p ,STR_DST, strlen(STR_DST))) {
-		p += (STR_DST_LENGTH - 1);
-		type = TO;
+	if (tn == (fsize/sizeof(field) - 1)) {
+		fsize *= 2;
+		Realloc(field, fsize);
+		ST_ADD(grow_field, 1);
+		if (fsize > st.field_size) {
+			ST_ADD(field_size, fsize - st.field_size);
+		}
 	}
-	else if (!strncmp(p, STR_DATE, strlen(STR_DATE))) {
-		p += (STR_DATE_LENGTH - 1);
-		type = DATE;
+	field[tn++] = slog + off;
+}
+
+void tokbegin (void)
+{
+	ttype = dosplit ? T_HEAD : T_NONE;
+	tin = 0;
+	tn = 0;
+}
+
+inline void tok (size_t n, int c)
+{
+	char *s = slog;
+
+	s[n] = tolower(c);
+	if (tin) {
+		if (c == SPACE || c == ']' || c == '\0') {
+			s[n] = '\0';
+			addfield(tbeg);
+			tbeg = n + 1;
+			tin = (c == SPACE);
+		}
 	}
-	else {
-		return;	/* not found */
+	else if (ttype == T_HEAD) {
+		if (c == '[') {
+			if (n == STR_SRC_LENGTH - 2 && !strncmp(s, STR_SRC, n + 1))
+				ttype = FROM;
+			else if (n == STR_DST_LENGTH - 2 && !strncmp(s, STR_DST, n + 1))
+				ttype = TO;
+			else if (n == STR_DATE_LENGTH - 2 && !strncmp(s, STR_DATE, n + 1))
+				ttype = DATE;
+			else
+				ttype = T_NONE;
+			tin = (ttype != T_NONE);
+			tbeg = n + 1;
+		}
+		else if (n >= STR_DATE_LENGTH - 2) {
+			ttype = T_NONE;
+		}
 	}
+}
 
-	n = 0;
-	q = p;
-	r = field;
-	for (; *p != ']' && *p != NULL; ++p) {
-		if (*p == SPACE) {
-			*p = NULL;
-			if (n == (fsize/sizeof(field) - 1)) {
-				fsize *= 2;
-				Realloc(field, fsize);
-				r = field;
-			}
-			r[n++] = q;
-			q = ++p;
-		}
+/*
+ * the line of "n" bytes is complete
+*/
+void tokend (size_t n)
+{
+	slog[n] = '\0';
+	if (tin) {
+		addfield(tbeg);	/* no closing bracket */
+		tin = 0;
 	}
-	
-	if (p == NULL) {
-		return;
+	if (ttype >= 0) {
+		setnfield(tn, ttype);
 	}
-	
-	*p = NULL;	/* clear bracket */
-	r[n++] = q;
-	setnfield (n , type);
+}
 
-	return;
+/*
+ * split the line of "n" bytes in "log"
+*/
+void tokline (size_t n)
+{
+	tokbegin();
+	for (size_t i = 0; i < n && ttype != T_NONE; i++) {
+		tok(i, log[i]);
+	}
+	tokend(n);
 }
 
-/********************************************
- * lower all
- ********************************************
+/*
+ * the "n" bytes in "log" are a "dst:[" line longer than STREAM_AT,
+ * the rest of it is read here. each receiver is given to the sink as
+ * soon as it is split and its bytes are dropped, only the one being
+ * read is kept after "dst:[", so the buffers stay about STREAM_AT.
+ * the receivers left at the end are the fields of the line as usual.
+ * returns the bytes kept, 0 if it is not a "dst:[" line.
 */
-char *tolowerall (char *p)
+size_t stream (FILE *in, size_t n, int *pc)
 {
-	char *q;
+	const size_t head = STR_DST_LENGTH - 1;
+	size_t m;
+	int c = 0;
 
-	q = p;
+	/* as decide() in mview.c takes it */
+	if (strncmp(log, STR_DST, head)) {
+		return 0;
+	}
+	tokbegin();
+	for (size_t i = 0; i < n && ttype != T_NONE; i++) {
+		tok(i, log[i]);
+	}
 
-	for (; *q != NULL; ++q) {
-		*q = tolower(*q);
+	for (;;) {
+		for (int i = 0; i < tn; i++) {
+			sink(field[i], nstream++ == 0);
+		}
+		tn = 0;
+		if (tbeg > head) {
+			m = n - tbeg;
+			memmove(log + head, log + tbeg, m);
+			memmove(slog + head, slog + tbeg, m);
+			ndrop += tbeg - head;
+			n = head + m;
+			tbeg = head;
+		}
+		if (n + 1 >= lsize) {
+			grow(n + 2);	/* a receiver longer than the rest */
+		}
+		while (n + 1 < lsize && (c = fgetc(in)) != EOF && c != NEWLINE) {
+			log[n] = (char)c;
+			tok(n, c);
+			n++;
+		}
+		if (c == EOF || c == NEWLINE) {
+			break;
+		}
 	}
+	log[n] = '\0';
+	tokend(n);
+	*pc = c;
 
-	return p;
+	return n;
 }
 
 /********************************************
@@ -209,7 +363,9 @@ char *getlog (FILE *in)
 {
 	char *t;	/* working pointer of "log" */
 	int c;		/* input */
-	int n;		/* index of "log" stream */
+	size_t n;	/* index of "log" stream */
+	size_t m = 0;	/* bytes kept of a streamed line */
+	uint64_t t0 = 0;	/* statistics */
 
 	if (log == NULL) {
 		lsize *= 2;
@@ -217,26 +373,237 @@ char *getlog (FILE *in)
 		Emalloc(slog, lsize);
 	}
 
+	ST_BEGIN(t0);
+	shrink();
+	nstream = 0;
+	ndrop = 0;
 	t = log;
 	for (n = 0; (c = fgetc(in)) != EOF && c != NEWLINE; ++n) {
-		if (n == lsize) {
-			lsize *= 2;
-			Realloc(log, lsize);
-			Realloc(slog, lsize);
-
+		if (n + 1 >= lsize) {
+			/*
+			 * a long "dst:[" line goes to the sink, if any
+			*/
+			t[n] = (char )c;
+			if (sink != NULL && dosplit && lsize >= STREAM_AT
+			    && (m = stream(in, n + 1, &c)) > 0) {
+				n = m;
+				break;
+			}
+			grow(n + 2);
 			t = log;
 		}
 		t[n] = (char )c;
 	}
-	t[n] = NULL;	/* termination */
-
-	memcpy(slog, log, lsize);
+	if (m == 0) {
+		t[n] = NULL;	/* termination */
+	}
 
-	split(tolowerall(slog));
+	llen = n;
+	loff = noff;
+	noff += ndrop + n + (c == NEWLINE);
+	ST_ADD(bytes, ndrop + n + (c == NEWLINE));
+	ST_ADD(lines, !(c == EOF && n == 0));
+	ST_END(m > 0 ? PH_SPLIT : PH_READ, t0);
+
+	if (dosplit && m == 0) {
+		ST_BEGIN(t0);
+		tokline(n);
+		ST_END(PH_SPLIT, t0);
+	}
 
 	return (c == EOF && n == 0) ? NULL : log;
 }
 
+/********************************************
+ * put log
+ ********************************************
+ *
+ * put a line which was already split somewhere else (e.g. read
+ * from the cache). the caller sets the fields by putfield() and
+ * setnfield(), getlog() state such as the offset is kept.
+ *
+*/
+char *putlog (const char *p, size_t n)
+{
+	shrink();
+	grow(n + 1);
+	nstream = 0;
+	memcpy(log, p, n);
+	log[n] = '\0';
+
+	llen = n;
+	loff = noff;
+	noff += n + 1;
+	ST_ADD(bytes, n + 1);
+	ST_ADD(lines, 1);
+
+	return log;
+}
+
+/********************************************
+ * set log
+ ********************************************
+ *
+ * same as getlog() but the line is given by the caller.
+ *
+*/
+char *setlog (const char *p, size_t n)
+{
+	uint64_t t0 = 0;	/* statistics */
+
+	putlog(p, n);
+
+	if (dosplit) {
+		ST_BEGIN(t0);
+		tokline(n);
+		ST_END(PH_SPLIT, t0);
+	}
+
+	return log;
+}
+
+/********************************************
+ * put field
+ ********************************************
+*/
+void putfield (int index, char *p)
+{
+	if (field == NULL) {
+		fsize *= 2;
+		Emalloc(field, fsize);
+	}
+	while (index >= fsize/sizeof(field)) {
+		fsize *= 2;
+		Realloc(field, fsize);
+		ST_ADD(grow_field, 1);
+		if (fsize > st.field_size) {
+			ST_ADD(field_size, fsize - st.field_size);
+		}
+	}
+	field[index] = p;
+}
+
+/********************************************
+ * get length
+ ********************************************
+*/
+size_t getlength (void)
+{
+	return llen;
+}
+
+/********************************************
+ * get lowered
+ ********************************************
+ *
+ * lowered copy of the envelope line returned by getlog(), the
+ * fields point into it. it is not updated by putlog().
+ *
+*/
+char *getlowered (void)
+{
+	return slog;
+}
+
+/********************************************
+ * get/set offset
+ ********************************************
+ *
+ * getoffset() returns the byte offset of the line which getlog()
+ * returned last, getnext() the one of the line to be read next.
+ * call setoffset() whenever a new input is opened
+ * or the input is repositioned.
+ *
+*/
+off_t getoffset (void)
+{
+	return loff;
+}
+
+off_t getnext (void)
+{
+	return noff;
+}
+
+void setoffset (off_t off)
+{
+	loff = noff = off;
+}
+
+/********************************************
+ * set split
+ ********************************************
+ *
+ * getlog() only reads the lines when it is turned off,
+ * for measuring the reader alone.
+ *
+*/
+void setsplit (int on)
+{
+	dosplit = on;
+}
+
+/********************************************
+ * set sink / get nstream
+ ********************************************
+ *
+ * getlog() gives the receivers of a "dst:[" line longer than
+ * STREAM_AT to "fn" one by one, with a flag set for the first one of
+ * the line, instead of keeping the whole line. the line returned then
+ * holds the receivers not given yet, getnstream() tells how many
+ * were. NULL turns it off, the line is split as a whole then.
+ *
+*/
+void setsink (void (*fn)(const char *, int))
+{
+	sink = fn;
+}
+
+int getnstream (void)
+{
+	return nstream;
+}
+
+/********************************************
+ * get epoch
+ ********************************************
+ *
+ * convert "YYYYMMDDHHMMSS" (UTC) to seconds since the epoch.
+ * missing trailing digits are taken as zero, -1 is returned
+ * on a malformed date.
+ *
+*/
+time_t getepoch (const char *p)
+{
+	int v[6] = {0, 1, 1, 0, 0, 0};	/* Y M D h m s */
+	int w[6] = {4, 2, 2, 2, 2, 2};	/* width of each */
+	long y, m, era, yoe, doy, doe;
+
+	for (int i = 0; i < 6 && *p != '\0'; i++) {
+		v[i] = 0;
+		for (int j = 0; j < w[i]; j++, p++) {
+			if (!isdigit((unsigned char)*p)) {
+				return (time_t)-1;
+			}
+			v[i] = v[i] * 10 + (*p - '0');
+		}
+	}
+	if (v[1] < 1 || v[1] > 12 || v[2] < 1 || v[2] > 31) {
+		return (time_t)-1;
+	}
+
+	/* days from civil, proleptic gregorian calendar */
+	y = v[0] - (v[1] <= 2);
+	m = v[1];
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = y - era * 400;
+	doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + v[2] - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return (time_t)((era * 146097 + doe - 719468) * 86400L
+		+ v[3] * 3600L + v[4] * 60L + v[5]);
+}
+
 
 /********************************************
  * debug section
@@ -250,6 +617,39 @@ char *getlog (FILE *in)
 
 int main (int argc, char **argv)
 {
+	static const char *name[] = {"src", "dst", "date"};
+	FILE *in;
+	char *p;
+	int type;
+
+	/*
+	 * print out the fields of each envelope line, one line each
+	*/
+	for (int i = 1; i < argc; i++) {
+		if ((in = fopen(argv[i], "r")) == NULL) {
+			sys_err(" ***error*** file open failure", SOURCE, __LINE__, 0);
+			exit(1);
+		}
+		setoffset(0);
+		while ((p = getlog(in)) != NULL) {
+			if (!strncasecmp(p, STR_SRC, strlen(STR_SRC)))
+				type = FROM;
+			else if (!strncasecmp(p, STR_DST, strlen(STR_DST)))
+				type = TO;
+			else if (!strncasecmp(p, STR_DATE, strlen(STR_DATE)))
+				type = DATE;
+			else
+				continue;
+
+			fprintf(stdout, "%s:", name[type]);
+			for (int j = 0; j < getnfield(type); j++) {
+				fprintf(stdout, " %s", getfield(j, type));
+			}
+			fprintf(stdout, "\n");
+		}
+		fclose(in);
+	}
+
 	exit(0);
 }
 
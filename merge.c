@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  merge.c
+#contents :  merge_open(), merge_next(), merge_close()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : misc.c
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  k-way merge of the inputs by date
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * every input keeps one pending message and the line which
+ * begins the next one, the inputs are ordered by the date of the
+ * pending message in a binary heap (or just in order of argv, when
+ * only whole messages are wanted as for "--dedup"). the lines are handed to
+ * setlog() by the caller, so nothing is lowered or split here.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"merge.c"
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _input {
+	FILE *fp;
+	int id;		/* position in argv, breaks ties */
+	off_t noff;	/* offset of the next line */
+	off_t loff;	/* offset of "line" */
+	char *line;	/* line read ahead */
+	size_t cap;
+	ssize_t len;	/* length of "line", -1 if none */
+	Msg msg;	/* pending message */
+} Input;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static Input *in	= NULL;
+static int nin		= 0;
+static Input **heap	= NULL;
+static int nheap	= 0;
+static Input *last	= NULL;	/* returned by merge_next() last */
+static int bydate	= 1;
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void merge_open(char **, int, int);
+Msg *merge_next(void);
+void merge_close(void);
+static ssize_t readline(Input *);
+static int fill(Input *);
+static int less(Input *, Input *);
+static void down(int);
+
+
+/********************************************
+ * read a line
+ ********************************************
+*/
+ssize_t readline (Input *p)
+{
+	p->loff = p->noff;
+	p->len = getline(&p->line, &p->cap, p->fp);
+	if (p->len < 0) {
+		return -1;
+	}
+	p->noff += p->len;
+
+	if (p->len > 0 && p->line[p->len - 1] == NEWLINE) {
+		p->len--;
+	}
+
+	return p->len;
+}
+
+/********************************************
+ * fill pending message
+ ********************************************
+*/
+int fill (Input *p)
+{
+	Msg *m = &p->msg;
+	char *q;
+	int n;
+
+	m->text.len = 0;
+	m->date[0] = '\0';
+
+	if (p->len < 0 && readline(p) < 0) {
+		return 0;
+	}
+	m->offset = p->loff;
+
+	do {
+		if (!strncmp(p->line, STR_DATE, strlen(STR_DATE))) {
+			q = p->line + STR_DATE_LENGTH - 1;
+			for (n = 0; n < sizeof(m->date) - 1
+			     && n < p->len - (STR_DATE_LENGTH - 1)
+			     && q[n] != ']'; n++) {
+				m->date[n] = q[n];
+			}
+			m->date[n] = '\0';
+		}
+		bufput(&m->text, p->line, p->len);
+		bufput(&m->text, "\n", 1);
+	} while (readline(p) >= 0
+		 && strncmp(p->line, STR_SRC, strlen(STR_SRC)));
+
+	return 1;
+}
+
+/********************************************
+ * compare pending messages
+ ********************************************
+*/
+int less (Input *a, Input *b)
+{
+	int c = bydate ? strcmp(a->msg.date, b->msg.date) : 0;
+
+	return c < 0 || (c == 0 && a->id < b->id);
+}
+
+/********************************************
+ * sift down
+ ********************************************
+*/
+void down (int i)
+{
+	Input *t;
+	int c;
+
+	for (; (c = 2 * i + 1) < nheap; i = c) {
+		if (c + 1 < nheap && less(heap[c + 1], heap[c])) {
+			c++;
+		}
+		if (!less(heap[c], heap[i])) {
+			break;
+		}
+		t = heap[i];
+		heap[i] = heap[c];
+		heap[c] = t;
+	}
+}
+
+/********************************************
+ * open merge
+ ********************************************
+*/
+void merge_open (char **files, int n, int sort)
+{
+	bydate = sort;
+	Calloc(in, n > 0 ? n : 1, sizeof(Input));
+	Calloc(heap, n > 0 ? n : 1, sizeof(Input *));
+
+	for (int i = 0; i < n; i++) {
+		Input *p = &in[nin];
+
+		if ((p->fp = fopen(files[i], "r")) == NULL) {
+			sys_err(" ***error*** file open failure", SOURCE, __LINE__, 0);
+			continue;
+		}
+		if (iscache(p->fp)) {
+			sys_err(" ***error*** cache can not be merged, skipped",
+				SOURCE, __LINE__, 0);
+			Fclose(p->fp);
+			continue;
+		}
+		p->id = i;
+		p->len = -1;
+		Estrdup(p->msg.name, files[i]);
+		nin++;
+
+		if (fill(p)) {
+			heap[nheap++] = p;
+		}
+	}
+
+	for (int i = nheap / 2 - 1; i >= 0; i--) {
+		down(i);
+	}
+}
+
+/********************************************
+ * next message
+ ********************************************
+ *
+ * returns the oldest pending message, it is valid until the next
+ * call. the input it came from is refilled then.
+ *
+*/
+Msg *merge_next (void)
+{
+	if (last != NULL) {
+		if (!fill(last)) {
+			heap[0] = heap[--nheap];
+		}
+		down(0);
+		last = NULL;
+	}
+
+	if (nheap == 0) {
+		return NULL;
+	}
+	last = heap[0];
+
+	return &last->msg;
+}
+
+/********************************************
+ * close merge
+ ********************************************
+*/
+void merge_close (void)
+{
+	for (int i = 0; i < nin; i++) {
+		Fclose(in[i].fp);
+		if (in[i].line) {
+			Efree(in[i].line);
+		}
+		buffree(&in[i].msg.text);
+	}
+	if (in) {
+		Efree(in);
+	}
+	if (heap) {
+		Efree(heap);
+	}
+	in = NULL;
+	heap = NULL;
+	nin = nheap = 0;
+	last = NULL;
+}
+
+/* end of source */
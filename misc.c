@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  misc.c
+#contents :  bufput(), bufvarint(), buffree(), getvarint(), strhash()
+#version  :  1.00
+#higher module : export.c, cache.c
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  growable buffer and hash for the binary outputs
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"misc.c"
+
+#define FNV_OFFSET	0xcbf29ce484222325ULL
+#define FNV_PRIME	0x100000001b3ULL
+
+
+/********************************************
+ * put bytes into buffer
+ ********************************************
+*/
+void bufput (Buf *b, const void *p, size_t n)
+{
+	if (b->len + n > b->size) {
+		if (b->size == 0) {
+			b->size = 64;
+		}
+		while (b->len + n > b->size) {
+			b->size *= 2;
+		}
+		Realloc(b->data, b->size);
+	}
+	memcpy(b->data + b->len, p, n);
+	b->len += n;
+}
+
+/********************************************
+ * put unsigned LEB128 into buffer
+ ********************************************
+*/
+void bufvarint (Buf *b, uint64_t v)
+{
+	unsigned char t[10];
+	int n;
+
+	for (n = 0; v >= 0x80; v >>= 7) {
+		t[n++] = (unsigned char)(v | 0x80);
+	}
+	t[n++] = (unsigned char)v;
+
+	bufput(b, t, n);
+}
+
+/********************************************
+ * free buffer
+ ********************************************
+*/
+void buffree (Buf *b)
+{
+	if (b->data) {
+		Efree(b->data);
+	}
+	memset(b, 0, sizeof(Buf));
+}
+
+/********************************************
+ * get unsigned LEB128 and advance pointer
+ ********************************************
+*/
+uint64_t getvarint (const unsigned char **p)
+{
+	const unsigned char *q = *p;
+	uint64_t v = 0;
+	int s = 0;
+
+	do {
+		v |= (uint64_t)(*q & 0x7f) << s;
+		s += 7;
+	} while (*q++ & 0x80);
+	*p = q;
+
+	return v;
+}
+
+/********************************************
+ * string hash (FNV-1a 64bit)
+ ********************************************
+*/
+uint64_t strhash (const char *p, size_t n)
+{
+	uint64_t h = FNV_OFFSET;
+
+	for (size_t i = 0; i < n; i++) {
+		h ^= (unsigned char)p[i];
+		h *= FNV_PRIME;
+	}
+
+	return h;
+}
+
+/* end of source */
@@ -56,6 +56,7 @@
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/stat.h>
 #include "mview.h"
 
 
@@ -70,34 +71,114 @@
 #define OUT_PREFIX	"dump_"
 
 
-/********************************************
- * type definition
- ********************************************
-*/
-typedef struct _addr {
-	char address[256];
-	struct _addr *next;
-} Addr;
-
-typedef struct _header {
-	char sender[256];
-	struct _addr *next;
-	char *date;
-	int write;
-} Header;
-
-
 /********************************************
  * global variable
  ********************************************
 */
 static FILE *pin;	/* input file */
-static FILE *pout;	/* output file */
+static THREAD FILE *pout;	/* output file */
+static THREAD char *input;	/* input file name, of the batch in a worker */
+static size_t osize;	/* output file name size */
+static char *output;	/* output entire file name */
+static char *out_prefix;	/* output file name prefix */
+static unsigned long int out_suffix;	/* output file name suffix */
+static unsigned long int idx;	/* index of matched message */
+
+/*
+ * "--pipeline" and "--daemon": a worker prints out to "pline" and
+ * writes down to "pout", both into its batch, the output stage or
+ * the daemon does the rest
+*/
+static THREAD FILE *pline;	/* stdout, or lines of the batch */
+static THREAD Batch *pbatch;	/* batch of the worker */
+static char *pdump;		/* message written down by "--uring" */
+static size_t pdsize;		/* size of "pdump" */
+static THREAD Header wlog;	/* envelope data of the worker */
+static Header *popt;		/* option '-r' or '-s' or '-d' */
+static Header *shead;		/* receivers streamed by getlog() */
 
 /*
  * option flag
 */
 int oflag 	= 0;	/* option -o */
+int xflag	= 0;	/* option -x, --export */
+int cflag	= 0;	/* option -c, --mkcache */
+int zflag	= 0;	/* option -z, --cache-compress */
+int aflag	= 0;	/* option -a, --archive */
+int mflag	= 0;	/* option -m, --merge */
+int uflag	= 0;	/* option -u, --dedup */
+int urflag	= 0;	/* option --uring */
+int skflag	= 0;	/* option --skip */
+int skupdate	= 0;	/* option --skip-update */
+static unsigned long limit = 0;	/* option --limit, 0 for none */
+
+/*
+ * long options, the ones without short option
+*/
+enum {
+	OPT_DEDUP_WINDOW	= 256,
+	OPT_DEDUP_MEM		= 257,
+	OPT_DEDUP_BODY		= 258,
+	OPT_STAGE		= 259,
+	OPT_STATS_JSON		= 260,
+	OPT_PIPELINE		= 261,
+	OPT_URING		= 262,
+	OPT_SENDER_RE		= 263,
+	OPT_RCPT_RE		= 264,
+	OPT_SKIP		= 265,
+	OPT_DAEMON		= 266,
+	OPT_CLIENT		= 267,
+	OPT_COUNT		= 268,
+	OPT_SKIP_UPDATE		= 269,
+	OPT_SAMPLE		= 270,
+	OPT_SAMPLE_BLOCKS	= 271,
+	OPT_LIMIT		= 272
+};
+
+/*
+ * stage to stop at, for the benchmark
+*/
+enum {
+	STAGE_READ	= 1,	/* getlog() without split */
+	STAGE_SPLIT	= 2,	/* getlog() */
+	STAGE_ALL	= 3
+};
+
+static int stage	= STAGE_ALL;
+
+static struct option longopts[] = {
+	{"date",	required_argument,	NULL,	'd'},
+	{"help",	no_argument,		NULL,	'h'},
+	{"output",	required_argument,	NULL,	'o'},
+	{"receiver",	required_argument,	NULL,	'r'},
+	{"sender",	required_argument,	NULL,	's'},
+	{"export",	required_argument,	NULL,	'x'},
+	{"mkcache",	required_argument,	NULL,	'c'},
+	{"cache-compress", no_argument,		NULL,	'z'},
+	{"archive",	required_argument,	NULL,	'a'},
+	{"threads",	required_argument,	NULL,	'j'},
+	{"extract",	required_argument,	NULL,	'e'},
+	{"merge",	no_argument,		NULL,	'm'},
+	{"dedup",	no_argument,		NULL,	'u'},
+	{"dedup-window",	required_argument,	NULL,	OPT_DEDUP_WINDOW},
+	{"dedup-mem",	required_argument,	NULL,	OPT_DEDUP_MEM},
+	{"dedup-body",	no_argument,		NULL,	OPT_DEDUP_BODY},
+	{"stage",	required_argument,	NULL,	OPT_STAGE},
+	{"stats-json",	optional_argument,	NULL,	OPT_STATS_JSON},
+	{"pipeline",	required_argument,	NULL,	OPT_PIPELINE},
+	{"uring",	no_argument,		NULL,	OPT_URING},
+	{"sender-re",	required_argument,	NULL,	OPT_SENDER_RE},
+	{"rcpt-re",	required_argument,	NULL,	OPT_RCPT_RE},
+	{"skip",	no_argument,		NULL,	OPT_SKIP},
+	{"skip-update",	no_argument,		NULL,	OPT_SKIP_UPDATE},
+	{"sample",	required_argument,	NULL,	OPT_SAMPLE},
+	{"sample-blocks",	required_argument,	NULL,	OPT_SAMPLE_BLOCKS},
+	{"limit",	required_argument,	NULL,	OPT_LIMIT},
+	{"daemon",	required_argument,	NULL,	OPT_DAEMON},
+	{"client",	required_argument,	NULL,	OPT_CLIENT},
+	{"count",	no_argument,		NULL,	OPT_COUNT},
+	{NULL,		0,			NULL,	0}
+};
 
 /*
  * max length of output file name
@@ -140,11 +221,23 @@ enum {
  ********************************************
 */
 static void print_usage (void);
-static void print_time (struct timeval *, struct timeval *);
+static void print_time (struct timeval *, struct timeval *, uint64_t);
 static void print_env (FILE *, Header *);
 static int match (Header *, Header *);
+static int prefix (const char *, const char *);
+static int match_sender (Header *, Header *);
+static int match_rcpt (Header *, Header *);
+static int match_date (Header *, Header *);
+static int match_all (Header *, Header *);
+static void pick (Header *);
+static void put_rcpt (Header *, const char *);
+static void put_stream (const char *, int);
 static int decide (char *, Header *, Header *);
+static void process (char *, Header *, Header *);
 static void freeall (Header *);
+static void work (Batch *);
+static void flush (Batch *);
+static void serve (Batch *, Query **, int);
 
 
 
@@ -161,7 +254,9 @@ void print_usage ()
 	int max = MAX_PREFIX_LENGTH;
 
 	fprintf(stdout,
-		"usage: viewlog [-h] [-d YYYYMMDDHHMMSS] [-o output-prefix] [-r receiver] [-s sender] file\n");
+		"usage: viewlog [-h] [-d YYYYMMDDHHMMSS] [-o output-prefix] [-r receiver] [-s sender] [-x export-file] [-c cache-file [-z]] [-a archive [-j threads]] [-m] [-u] file\n");
+	fprintf(stdout,
+		"       viewlog -e N archive\n");
 	fprintf(stdout,
 		"options:\n");
 	fprintf(stdout,
@@ -174,6 +269,56 @@ void print_usage ()
 		"        -r<eceiver> pick up only specified the receiver\n");
 	fprintf(stdout,
 		"        -s<ender>   pick up only specified the sender\n");
+	fprintf(stdout,
+		"        -x, --export  write matched envelopes to the file in columnar binary\n");
+	fprintf(stdout,
+		"        -c, --mkcache write the inputs to the file as mview cache\n");
+	fprintf(stdout,
+		"        -z, --cache-compress  compress the blocks of the cache\n");
+	fprintf(stdout,
+		"        -a, --archive write down messages to the compressed archive instead of files\n");
+	fprintf(stdout,
+		"        -j, --threads number of compression threads for the archive\n");
+	fprintf(stdout,
+		"        -e, --extract print out message N of the archive\n");
+	fprintf(stdout,
+		"        -m, --merge   merge the messages of all files by date\n");
+	fprintf(stdout,
+		"        -u, --dedup   drop messages seen before (e.g. on another relay)\n");
+	fprintf(stdout,
+		"            --dedup-window=SEC  keep fingerprints exactly for SEC seconds (3600)\n");
+	fprintf(stdout,
+		"            --dedup-mem=MB      size of bloom filter for older ones (16)\n");
+	fprintf(stdout,
+		"            --dedup-body        fingerprint the body too\n");
+	fprintf(stdout,
+		"            --stage=read|split  stop after reading/splitting (benchmark)\n");
+	fprintf(stdout,
+		"            --stats-json[=FILE] print out counters and timers as json (stderr)\n");
+	fprintf(stdout,
+		"            --pipeline=N        read, match and write in N+2 threads\n");
+	fprintf(stdout,
+		"            --uring             read and write down by io_uring (linux)\n");
+	fprintf(stdout,
+		"            --sender-re=RE      pick up senders matching one of the RE\n");
+	fprintf(stdout,
+		"            --rcpt-re=RE        pick up if a receiver matches one of the RE\n");
+	fprintf(stdout,
+		"            --skip              skip blocks by file.skip, made if missing\n");
+	fprintf(stdout,
+		"            --skip-update       bring file.skip up to date, no query\n");
+	fprintf(stdout,
+		"            --sample=R          take a part R (0-1] of the messages\n");
+	fprintf(stdout,
+		"            --sample-blocks=R   read a part R (0-1] of the 1MB blocks\n");
+	fprintf(stdout,
+		"            --limit=N           stop reading after N matches\n");
+	fprintf(stdout,
+		"            --daemon=SOCKET     answer the queries of --client on SOCKET\n");
+	fprintf(stdout,
+		"            --client=SOCKET     ask the daemon on SOCKET instead of reading\n");
+	fprintf(stdout,
+		"            --count             print out the number of matches only (--client)\n");
 
 	exit(1);
 }
@@ -183,7 +328,9 @@ void print_usage ()
  * print time of excusion
  ********************************************
 */
-void print_time (struct timeval *s, struct timeval *e)
+void print_time (struct timeval *s, struct timeval *e, uint64_t ns)
+	/* wall clock of starting/ending */
+	/* elapsed time by the monotonic clock */
 {
 	/*
 	 * ctime return char's pointer with a line feed,
@@ -192,12 +339,7 @@ void print_time (struct timeval *s, struct timeval *e)
 	fprintf(stdout, "Start Time: %s", ctime(&(s->tv_sec)));
 	fprintf(stdout, "End   Time: %s", ctime(&(e->tv_sec)));
 
-	if (s->tv_sec == e->tv_sec) {
-		fprintf(stdout, "Eraps(ms): %lu\n", (e->tv_usec - s->tv_usec));
-	}
-	else {
-		fprintf(stdout, "Eraps(s): %lu\n", (e->tv_sec - s->tv_sec));
-	}
+	fprintf(stdout, "Eraps(ms): %.3f\n", ns / 1e6);
 
 	return;
 }
@@ -208,19 +350,18 @@ void print_time (struct timeval *s, struct timeval *e)
 */
 void print_env (FILE *o, Header *p)
 {
-	int tos;		/* Number of receiver address */
-	Addr *s;		/* Temporary pointer to search receiver address */
-
-	tos = getnfield (TO);
-	s = p->next;
+	Rcpt r;			/* receivers read back */
+	const char *s;		/* receiver address */
 
 	fprintf(o, "src:[%s]\n", p->sender);
 	fprintf(o, "dst:[");
-	for (int i = 0 ; i < tos -1 ; i++) {
-		fprintf(o, "%s ", s->address);
-		s = s->next;
+	for (s = rcpt_first(p, &r); s != NULL; ) {
+		fprintf(o, "%s", s);
+		if ((s = rcpt_next(&r)) != NULL) {
+			fprintf(o, " ");
+		}
 	}
-	fprintf(o, "%s]\n" , s->address);
+	fprintf(o, "]\n");
 	fprintf(o, "date:[%s]\n", p->date);
 }
 
@@ -236,13 +377,30 @@ int match (Header *l, Header *o)
 	 * W_MATCH(2): write down
 	*/
 
-	int tos;	/* Number of receiver address */
-	Addr *s;	/* Temporary pointer to search receiver address */
+	Rcpt r;		/* receivers read back */
+	const char *s;	/* receiver address */
 
-	if (l->sender == NULL || l->next->address == NULL || l->date == NULL) {
+	if (l->next == NULL || l->date == NULL) {
 		return UNMATCH;
 	}
 
+	/*
+	 * "--sender-re" and "--rcpt-re" have to match as well
+	*/
+	if (re_count(FROM) && !re_match(FROM, l->sender)) {
+		return UNMATCH;
+	}
+	if (re_count(TO)) {
+		int hit = 0;
+
+		for (s = rcpt_first(l, &r); s != NULL && !hit; s = rcpt_next(&r)) {
+			hit = re_match(TO, s);
+		}
+		if (!hit) {
+			return UNMATCH;
+		}
+	}
+
 	if (*o->sender != NULL) {
 		/* obsoleted
 		fprintf(stderr, "[%03d] l->sender(%s), o->sender(%s)\n",
@@ -250,25 +408,21 @@ int match (Header *l, Header *o)
 			l->sender, o->sender);
 		*/
 		if (!strncmp(l->sender, o->sender, strlen(o->sender))) {
-			return oflag ? W_MATCH : P_MATCH;
+			return o->write ? W_MATCH : P_MATCH;
 		}
 		return UNMATCH;
 	}
-	else if (*o->next->address != NULL) {
-		tos = getnfield (TO);
-		s = l->next;
-
-		for (int i = 0 ; i < tos ; i++) {
-			if (!strncmp(s->address, o->next->address, strlen(o->next->address))) {
-				return oflag ? W_MATCH : P_MATCH;
+	else if (o->next != NULL && *o->next->address != NULL) {
+		for (s = rcpt_first(l, &r); s != NULL; s = rcpt_next(&r)) {
+			if (!strncmp(s, o->next->address, strlen(o->next->address))) {
+				return o->write ? W_MATCH : P_MATCH;
 			}
-			s = s->next;
 		}
 		return UNMATCH;
 	}
 	else if (o->date) {
 		if (!strncmp(l->date, o->date, strlen(o->date))) {
-			return oflag ? W_MATCH : P_MATCH;
+			return o->write ? W_MATCH : P_MATCH;
 		}
 		return UNMATCH;
 	}
@@ -277,7 +431,130 @@ int match (Header *l, Header *o)
 	 * if not set option '-s' or '-r', print out or write down all
 	 * of envelopes
 	*/
-	return oflag ? W_MATCH : P_MATCH;
+	return o->write ? W_MATCH : P_MATCH;
+}
+
+/********************************************
+ * matchers for one option
+ ********************************************
+ *
+ * same as match() for a query of "-s", "-r" or "-d" only (or none)
+ * and no regular expression, the one for the query is picked once
+ * by pick() instead of looking at the options for every message.
+ * it is a dispatch at run time through "match" of the options, the
+ * loops around it are the same for every query.
+ *
+*/
+int prefix (const char *s, const char *p)
+{
+	while (*p != '\0' && *p == *s) {
+		p++;
+		s++;
+	}
+
+	return *p == '\0';
+}
+
+int match_sender (Header *l, Header *o)
+{
+	if (l->next == NULL || l->date == NULL) {
+		return UNMATCH;
+	}
+	if (prefix(l->sender, o->sender)) {
+		return o->write ? W_MATCH : P_MATCH;
+	}
+
+	return UNMATCH;
+}
+
+int match_rcpt (Header *l, Header *o)
+{
+	Rcpt r;		/* receivers read back */
+	const char *s;	/* receiver address */
+
+	if (l->next == NULL || l->date == NULL) {
+		return UNMATCH;
+	}
+	for (s = rcpt_first(l, &r); s != NULL; s = rcpt_next(&r)) {
+		if (prefix(s, o->next->address)) {
+			return o->write ? W_MATCH : P_MATCH;
+		}
+	}
+
+	return UNMATCH;
+}
+
+int match_date (Header *l, Header *o)
+{
+	if (l->next == NULL || l->date == NULL) {
+		return UNMATCH;
+	}
+	if (prefix(l->date, o->date)) {
+		return o->write ? W_MATCH : P_MATCH;
+	}
+
+	return UNMATCH;
+}
+
+int match_all (Header *l, Header *o)
+{
+	if (l->next == NULL || l->date == NULL) {
+		return UNMATCH;
+	}
+
+	return o->write ? W_MATCH : P_MATCH;
+}
+
+/*
+ * the matcher of the options, in the order of match(). every option
+ * Header given to decide() has been through it.
+*/
+void pick (Header *o)
+{
+	if (re_count(FROM) || re_count(TO)) {
+		o->match = match;
+	}
+	else if (*o->sender != '\0') {
+		o->match = match_sender;
+	}
+	else if (o->next != NULL && *o->next->address != '\0') {
+		o->match = match_rcpt;
+	}
+	else if (o->date) {
+		o->match = match_date;
+	}
+	else {
+		o->match = match_all;
+	}
+}
+
+/********************************************
+ * receivers
+ ********************************************
+*/
+void put_rcpt (Header *l, const char *q)
+{
+	if (*q == NULL) {
+		rcpt_add(l, NULL_RECEIVER);
+	}
+	else if (strlen(q) >= 256) {
+		fprintf (stdout , "** Too long address(%s)\n" , q);
+		fprintf (stdout , "** Fail to copy receiver address **");
+	}
+	else {
+		rcpt_add(l, q);
+	}
+}
+
+/*
+ * the receivers of a long "dst:[" line streamed by getlog()
+*/
+void put_stream (const char *q, int first)
+{
+	if (first) {
+		rcpt_clear(shead);
+	}
+	put_rcpt(shead, q);
 }
 
 /********************************************
@@ -289,11 +566,12 @@ int decide (char *p, Header *l, Header *o)
 	/* envelope data of log */
 	/* envelope data of option */
 {
-	static unsigned long int idx = 0;
 	char *q;
 	int rm;		/* return code of match() */
 	int tos;	/* Numer of receiver address */
-	Addr *s;	/* Temporary pointer to search receiver address */
+	Rcpt r;		/* receivers read back */
+	const char *s;	/* receiver address */
+	uint64_t t0 = 0;	/* statistics */
 
 	/*
 	 * src:[   set sender
@@ -301,9 +579,10 @@ int decide (char *p, Header *l, Header *o)
 	 * date:[  set date
 	 * Size:   close file and clear pout
 	*/
-	tos = getnfield(TO);
-
 	if (!strncmp(p, STR_SRC, strlen(STR_SRC))) {
+		ST_ADD(messages, 1);
+		l->offset = getoffset();
+		l->hit = OFF;
 		q = getfield(0 , FROM);
 		//Estrdup(l->sender, (*q == NULL ? NULL_SENDER : q));
 		if (*q == NULL)
@@ -320,41 +599,47 @@ int decide (char *p, Header *l, Header *o)
 		return NOOP;
 	}
 	else if (!strncmp(p, STR_DST, strlen(STR_DST))) {
-		s = l->next;
-
+		/*
+		 * the ones streamed by getlog() are there already
+		*/
+		if (getnstream() == 0) {
+			rcpt_clear(l);
+		}
+		tos = getnfield(TO);
 		for (int i = 0 ; i < tos ; i++) {
-			if (s->next == NULL) {
-				Emalloc (s->next , sizeof (Addr));
-			}
-			q = getfield (i , TO);
-			//Estrdup (s->address , (*q == NULL ? NULL_RECEIVER : q));
-			if(*q == NULL)
-				strcpy (s->address , NULL_RECEIVER);
-			else {
-				if (strlen(q) >= 256) {
-					fprintf (stdout , "** Too long address(%s)\n" , q);
-					fprintf (stdout , "** Fail to copy receiver address **");
-
-					return NOOP;
-				}	
-			strcpy (s->address , q);
-			}
-			s = s->next;
+			put_rcpt(l, getfield(i, TO));
 		}
 		return NOOP;
 	}
 	else if (!strncmp(p, STR_DATE, strlen(STR_DATE))) {
+		if (l->date) {
+			Efree(l->date);
+		}
 		Estrdup(l->date, getfield(0 , DATE));
-		rm = match(l, o);
+
+		/*
+		 * "--sample": the rest of the message is passed through
+		*/
+		if (!sample_msg(l)) {
+			return NOOP;
+		}
+		ST_BEGIN(t0);
+		rm = o->match(l, o);
+		ST_END(PH_MATCH, t0);
 		if (rm == W_MATCH || rm == P_MATCH) {
-			fprintf(stdout, "%06lu %s ", ++idx, l->sender);
+			ST_ADD(matches, 1);
+			ST_BEGIN(t0);
+			l->hit = ON;
+			if (pbatch == NULL) {
+				fprintf(pline, "%06lu ", ++idx);
+			}
+			fprintf(pline, "%s ", l->sender);
 
-			s = l->next;
-			for (int i = 0 ; i < tos ; i++ ) {
-				fprintf(stdout, "%s ", s->address);
-				s = s->next;
+			for (s = rcpt_first(l, &r); s != NULL; s = rcpt_next(&r)) {
+				fprintf(pline, "%s ", s);
 			}
-			fprintf(stdout, "%s\n", l->date);
+			fprintf(pline, "%s\n", l->date);
+			ST_END(PH_PRINT, t0);
 			if (rm == W_MATCH) {
 				l->write = ON;
 				return OPEN;
@@ -385,6 +670,11 @@ int decide (char *p, Header *l, Header *o)
 		*/
 	}
 	else if (!strncmp(p, STR_SIZE, strlen(STR_SIZE))) {
+		l->size = strtoul(p + STR_SIZE_LENGTH - 1, NULL, 10);
+		if (xflag && l->hit == ON) {
+			exp_put(input, l);
+		}
+		l->hit = OFF;
 		if (l->write == ON) {
 			return CLOSE;
 		}
@@ -398,6 +688,68 @@ int decide (char *p, Header *l, Header *o)
 	return NOOP;
 }
 
+/********************************************
+ * process a line
+ ********************************************
+*/
+void process (char *ibuff, Header *l, Header *o)
+{
+	int rt;			/* return code for "decide()" */
+	uint64_t t0 = 0;	/* statistics */
+
+	if ((rt = decide(ibuff, l, o)) == NOOP) {
+		return;
+	}
+
+	ST_BEGIN(t0);
+	if (rt == WRITE) {
+		fprintf(pout, "%s\n", ibuff);
+	}
+	else if (rt == OPEN) {
+		ST_ADD(dumps, 1);
+		if (pbatch == NULL) {
+			snprintf(output, osize, "%s%lu",
+				 out_prefix, ++out_suffix);
+		}
+		if (pbatch || (urflag && !aflag)) {
+			pout = pbatch ? open_memstream(&pbatch->mem, &pbatch->msize)
+				: open_memstream(&pdump, &pdsize);
+			print_env(pout, l);
+			ST_END(PH_DUMP, t0);
+			return;
+		}
+		if (aflag) {
+			pout = arc_begin();
+		}
+		else {
+			Fopen(pout, output, "w");
+		}
+		print_env(pout, l);
+	}
+	else if (rt == CLOSE) {
+		//freeall(l);
+		l->write = NOOP;
+		if (pbatch) {
+			Fclose(pout);
+			bufvarint(&pbatch->dump, pbatch->msize);
+			bufput(&pbatch->dump, pbatch->mem, pbatch->msize);
+			Efree(pbatch->mem);
+			pbatch->mem = NULL;
+		}
+		else if (urflag && !aflag) {
+			Fclose(pout);
+			ur_dump(output, pdump, pdsize);
+		}
+		else if (aflag) {
+			arc_end(pout);
+		}
+		else {
+			Fclose(pout);
+		}
+	}
+	ST_END(PH_DUMP, t0);
+}
+
 /********************************************
  * free all information
  ********************************************
@@ -425,28 +777,186 @@ void freeall (Header *p)
 	return;
 }
 
+/********************************************
+ * worker of the pipeline, match a batch
+ ********************************************
+*/
+void work (Batch *b)
+{
+	char *ibuff;
+	char *line;
+	size_t size;
+
+	if (wlog.next == NULL) {
+		Emalloc(wlog.next, sizeof(Addr));
+	}
+	pbatch = b;
+	pline = open_memstream(&line, &size);
+	input = b->name;
+	setoffset(b->offset);
+
+	for (size_t i = 0, e; i < b->in.len; i = e + 1) {
+		for (e = i; b->in.data[e] != NEWLINE; e++)
+			;
+		ibuff = setlog(b->in.data + i, e - i);
+		process(ibuff, &wlog, popt);
+	}
+
+	/*
+	 * a message without "Size:" is not carried over the batch
+	*/
+	if (wlog.write == ON) {
+		process(STR_SIZE, &wlog, popt);
+	}
+
+	Fclose(pline);
+	bufput(&b->out, line, size);
+	Efree(line);
+	pbatch = NULL;
+}
+
+/********************************************
+ * output of the pipeline, in order of input
+ ********************************************
+*/
+void flush (Batch *b)
+{
+	const unsigned char *p;
+	const unsigned char *e;
+	size_t n;
+	char *q;
+	uint64_t t0 = 0;	/* statistics */
+
+	for (size_t i = 0, e; i < b->out.len; i = e + 1) {
+		for (e = i; b->out.data[e] != NEWLINE; e++)
+			;
+		fprintf(stdout, "%06lu %.*s\n", ++idx,
+			(int)(e - i), b->out.data + i);
+	}
+
+	ST_BEGIN(t0);
+	p = (const unsigned char *)b->dump.data;
+	e = p + b->dump.len;
+	while (p < e) {
+		n = getvarint(&p);
+		snprintf(output, osize, "%s%lu", out_prefix, ++out_suffix);
+		if (urflag && !aflag) {
+			Emalloc(q, n ? n : 1);
+			memcpy(q, p, n);
+			ur_dump(output, q, n);
+			p += n;
+			continue;
+		}
+		if (aflag) {
+			pout = arc_begin();
+		}
+		else {
+			Fopen(pout, output, "w");
+		}
+		if (pout != NULL) {
+			fwrite(p, 1, n, pout);
+			if (aflag) {
+				arc_end(pout);
+			}
+			else {
+				Fclose(pout);
+			}
+		}
+		p += n;
+	}
+	ST_END(PH_DUMP, t0);
+}
+
+/********************************************
+ * daemon, match a chunk for the queries
+ ********************************************
+ *
+ * the lines are split once, each query has its own envelope data
+ * and batch for the results.
+ *
+*/
+void serve (Batch *b, Query **q, int nq)
+{
+	char *ibuff;
+
+	for (int k = 0; k < nq; k++) {
+		q[k]->line = open_memstream(&q[k]->lbuf, &q[k]->lsize);
+		if (q[k]->opt.match == NULL) {
+			pick(&q[k]->opt);
+		}
+	}
+	setoffset(b->offset);
+
+	for (size_t i = 0, e; i < b->in.len; i = e + 1) {
+		for (e = i; e < b->in.len && b->in.data[e] != NEWLINE; e++)
+			;
+		ibuff = setlog(b->in.data + i, e - i);
+		for (int k = 0; k < nq; k++) {
+			pbatch = &q[k]->res;
+			pline = q[k]->line;
+			pout = q[k]->pout;
+			process(ibuff, &q[k]->log, &q[k]->opt);
+			q[k]->pout = pout;
+		}
+	}
+
+	for (int k = 0; k < nq; k++) {
+		pbatch = &q[k]->res;
+		pline = q[k]->line;
+		pout = q[k]->pout;
+		if (q[k]->log.write == ON) {
+			process(STR_SIZE, &q[k]->log, &q[k]->opt);
+		}
+		q[k]->pout = NULL;
+		Fclose(q[k]->line);
+		q[k]->line = NULL;
+		bufput(&q[k]->res.out, q[k]->lbuf, q[k]->lsize);
+		Efree(q[k]->lbuf);
+		q[k]->lbuf = NULL;
+	}
+	pbatch = NULL;
+}
+
 /********************************************
  * main routine
  ********************************************
 */
 int main (int argc, char **argv)
 {
-	char ch;		/* getopt */
+	int ch;			/* getopt */
 
-	char *input;		/* input file name */
 	char *ibuff;		/* input ibuffer */
-	size_t osize;		/* output file name size */
-	char *output;		/* output entire file name */
-	char *out_prefix;	/* output file name prefix */
-	unsigned long int out_suffix;	/* output file name suffix */
+	char *(*reader)(FILE *);	/* getlog() or getcache() */
+	char *cache_out;	/* cache file name */
+	char *arc_out;		/* archive file name */
+	int threads;		/* compression threads */
+	unsigned long extract;	/* message to extract */
+	long dd_window;		/* --dedup-window */
+	size_t dd_mem;		/* --dedup-mem */
+	int dd_body;		/* --dedup-body */
+	Msg *m;			/* message of "--merge" */
+	int workers;		/* --pipeline */
+	struct stat sb;		/* input of "--pipeline" */
+	char *sock_d;		/* --daemon */
+	char *sock_c;		/* --client */
+	int count;		/* --count */
+	int useskip;		/* skip index of the input is used */
+	int useblk;		/* blocks of the input are sampled */
+	int resync;		/* looking for "src:[" after a jump */
+	double mrate;		/* --sample */
+	double brate;		/* --sample-blocks */
+	double rate;		/* of either */
+	char *q;		/* end of the rate */
+	off_t next;		/* offset to read next */
+	char *name;		/* input in the cache */
 
 	Header log;		/* envelope data of mail */
 	Header opt;		/* option '-r' or '-s' or '-d' */
 
-	int rt;			/* return code for "decide()" */
-
 	struct timeval stp;	/* time of starting */
 	struct timeval etp;	/* time of ending */
+	uint64_t mstp;		/* monotonic time of starting */
+	FILE *pstat;		/* output of --stats-json */
 
 	/******************************************
 	 * initialize
@@ -457,6 +967,18 @@ int main (int argc, char **argv)
 	output = NULL;
 	out_prefix = NULL;
 	out_suffix = 0;
+	cache_out = NULL;
+	arc_out = NULL;
+	threads = sysconf(_SC_NPROCESSORS_ONLN);
+	extract = 0;
+	dd_window = 3600;
+	dd_mem = 16;
+	dd_body = OFF;
+	workers = 0;
+	sock_d = sock_c = NULL;
+	count = OFF;
+	mrate = brate = 1.0;
+	pline = stdout;
 	memset(&log, NULL, sizeof(Header));
 	memset(&opt, NULL, sizeof(Header));
 
@@ -469,12 +991,15 @@ int main (int argc, char **argv)
 	if (gettimeofday(&stp, NULL)) {
 		sys_err(" gettimeofday failure", SOURCE, __LINE__, 0);
 	}
+	mstp = st_now();
+	pstat = stderr;
 
 	/*
 	 * get options
 	*/
-	while ((ch = getopt(argc, argv, "d:h:o:r:s:")) != -1) {
-		switch((char)ch) {
+	while ((ch = getopt_long(argc, argv, "a:c:d:e:hj:mo:r:s:ux:z",
+				 longopts, NULL)) != -1) {
+		switch(ch) {
 		case 'd':
 			Estrdup(opt.date, optarg);
 			break;
@@ -494,6 +1019,110 @@ int main (int argc, char **argv)
 				out_prefix[MAX_PREFIX_LENGTH + 1] = NULL;
 			}
 			break;
+		case 'x':
+			xflag = ON;
+			exp_open(optarg);
+			break;
+		case 'c':
+			cflag = ON;
+			Estrdup(cache_out, optarg);
+			break;
+		case 'z':
+			zflag = ON;
+			break;
+		case 'a':
+			aflag = oflag = ON;
+			Estrdup(arc_out, optarg);
+			break;
+		case 'j':
+			threads = atoi(optarg);
+			break;
+		case 'e':
+			extract = strtoul(optarg, NULL, 10);
+			break;
+		case 'm':
+			mflag = ON;
+			break;
+		case 'u':
+			uflag = ON;
+			break;
+		case OPT_DEDUP_WINDOW:
+			dd_window = atol(optarg);
+			break;
+		case OPT_DEDUP_MEM:
+			dd_mem = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_DEDUP_BODY:
+			dd_body = ON;
+			break;
+		case OPT_STATS_JSON:
+			stflag = ON;
+			if (optarg != NULL) {
+				Fopen(pstat, optarg, "w");
+				if (pstat == NULL) {
+					exit(1);
+				}
+			}
+			break;
+		case OPT_PIPELINE:
+			workers = atoi(optarg);
+			break;
+		case OPT_SENDER_RE:
+		case OPT_RCPT_RE:
+			if (re_add(ch == OPT_SENDER_RE ? FROM : TO, optarg) < 0) {
+				fprintf(stderr, "bad pattern \"%s\": %s\n",
+					optarg, re_error());
+				exit(1);
+			}
+			break;
+		case OPT_SKIP:
+			skflag = ON;
+			break;
+		case OPT_SKIP_UPDATE:
+			skupdate = ON;
+			break;
+		case OPT_SAMPLE:
+		case OPT_SAMPLE_BLOCKS:
+			rate = strtod(optarg, &q);
+			if (*q != '\0' || !(rate > 0.0 && rate <= 1.0)) {
+				sys_err(" **error** the rate has to be in (0, 1]",
+					SOURCE, __LINE__, 0);
+				exit(1);
+			}
+			if (ch == OPT_SAMPLE) {
+				mrate = rate;
+			}
+			else {
+				brate = rate;
+			}
+			break;
+		case OPT_LIMIT:
+			limit = strtoul(optarg, NULL, 10);
+			break;
+		case OPT_DAEMON:
+			sock_d = optarg;
+			break;
+		case OPT_CLIENT:
+			sock_c = optarg;
+			break;
+		case OPT_COUNT:
+			count = ON;
+			break;
+		case OPT_URING:
+			urflag = ON;
+			break;
+		case OPT_STAGE:
+			if (!strcmp(optarg, "read")) {
+				stage = STAGE_READ;
+				setsplit(OFF);
+			}
+			else if (!strcmp(optarg, "split")) {
+				stage = STAGE_SPLIT;
+			}
+			else {
+				stage = STAGE_ALL;
+			}
+			break;
 		case 'h':
 		default:
 			print_usage();
@@ -508,14 +1137,155 @@ int main (int argc, char **argv)
 	/*
 	 * output file name
 	*/
-	if (!oflag) {
+	if (out_prefix == NULL) {
 		Estrdup(out_prefix, OUT_PREFIX);
 	}
 	osize = MAX_PREFIX_LENGTH + MAX_SUFFIX_LENGTH + 1;
 	Emalloc(output, osize);
 	memset(output, NULL, osize);
+	opt.write = oflag;
+	pick(&opt);
+
+	/*
+	 * "--daemon" serves until killed, "--client" asks it. the
+	 * patterns, the rates and the limit are not part of a query.
+	*/
+	if ((sock_d || sock_c) && (re_count(FROM) || re_count(TO)
+				   || mrate < 1.0 || brate < 1.0 || limit > 0)) {
+		sys_err(" **error** --sender-re/--rcpt-re/--sample/--sample-blocks/--limit are not available with --daemon/--client",
+			SOURCE, __LINE__, 0);
+		exit(1);
+	}
+	if (sock_d) {
+		return daemon_run(sock_d, serve);
+	}
+	if (sock_c) {
+		return client_run(sock_c, argv + optind, argc - optind, &opt,
+				  oflag ? out_prefix : NULL, count);
+	}
+
+	if (extract) {
+		if (optind >= argc) {
+			print_usage();
+		}
+		return arc_extract(argv[optind], extract, stdout) ? 1 : 0;
+	}
+
+	if ((mflag || uflag) && cflag) {
+		sys_err(" **warning** -c is not available with -m/-u, ignored",
+			SOURCE, __LINE__, 0);
+		cflag = OFF;
+	}
+	if (workers > 0 && (mflag || uflag || xflag || cflag || stage != STAGE_ALL)) {
+		sys_err(" **warning** --pipeline is not available with -m/-u/-x/-c/--stage, ignored",
+			SOURCE, __LINE__, 0);
+		workers = 0;
+	}
+	for (int i = optind ; workers > 0 && i < argc ; i++) {
+		if (stat(argv[i], &sb) == 0 && S_ISREG(sb.st_mode)
+		    && (pin = fopen(argv[i], "r")) != NULL) {
+			if (iscache(pin)) {
+				sys_err(" **warning** --pipeline does not read a cache, ignored",
+					SOURCE, __LINE__, 0);
+				workers = 0;
+			}
+			Fclose(pin);
+		}
+	}
+	if (brate < 1.0 && (workers > 0 || mflag || uflag || stage != STAGE_ALL)) {
+		sys_err(" **warning** --sample-blocks is not available with -m/-u/--pipeline/--stage, ignored",
+			SOURCE, __LINE__, 0);
+		brate = 1.0;
+	}
+	if (limit > 0 && workers > 0) {
+		sys_err(" **warning** --limit is not available with --pipeline, ignored",
+			SOURCE, __LINE__, 0);
+		limit = 0;
+	}
+	if (skflag && (workers > 0 || mflag || uflag || stage != STAGE_ALL
+		       || brate < 1.0)) {
+		sys_err(" **warning** --skip is not available with -m/-u/--pipeline/--stage/--sample-blocks, ignored",
+			SOURCE, __LINE__, 0);
+		skflag = OFF;
+	}
+	sample_open(mrate, brate);
+	skip_query(opt.sender, opt.next ? opt.next->address : NULL, opt.date);
+	if (urflag && !ur_open()) {
+		sys_err(" **warning** io_uring is not available, ignored",
+			SOURCE, __LINE__, 0);
+		urflag = OFF;
+	}
+	if (cflag) {
+		cache_open(cache_out, zflag);
+	}
+	if (aflag) {
+		arc_open(arc_out, threads);
+	}
+
+	/*
+	 * "-m": messages of all files in order of the date
+	 * "-u": whole messages, to be fingerprinted
+	*/
+	if (mflag || uflag) {
+		if (uflag) {
+			dedup_open(dd_window, dd_mem * 1024 * 1024, dd_body);
+		}
+		merge_open(argv + optind, argc - optind, mflag);
+		while ((m = merge_next()) != NULL) {
+			if (uflag && dedup_seen(m)) {
+				continue;
+			}
+			input = m->name;
+			setoffset(m->offset);
+			for (size_t b = 0, e; b < m->text.len; b = e + 1) {
+				for (e = b; m->text.data[e] != NEWLINE; e++)
+					;
+				ibuff = setlog(m->text.data + b, e - b);
+				process(ibuff, &log, &opt);
+			}
+			if (limit > 0 && idx >= limit) {
+				break;
+			}
+		}
+		merge_close();
+		if (uflag) {
+			fprintf(stdout, "Duplicate: %lu\n", dedup_close());
+		}
+		optind = argc;
+	}
 
-	for (int i = optind ; i < argc ; i++) {
+	/*
+	 * "--skip-update": only the appended part of each log is read
+	*/
+	for (int i = optind ; skupdate && i < argc ; i++) {
+		if (stat(argv[i], &sb) != 0 || !S_ISREG(sb.st_mode)
+		    || (pin = fopen(argv[i], "r")) == NULL) {
+			continue;
+		}
+		skip_begin(argv[i]);
+		if (fseeko(pin, skip_tail(), SEEK_SET) == 0) {
+			setoffset(skip_tail());
+			while ((ibuff = getlog(pin)) != NULL) {
+				skip_line(ibuff);
+			}
+		}
+		skip_end();
+		Fclose(pin);
+	}
+	if (skupdate) {
+		optind = argc;
+	}
+
+	/*
+	 * "--pipeline": the reader, the workers and this thread
+	*/
+	if (workers > 0) {
+		popt = &opt;
+		pipe_run(argv + optind, argc - optind, workers, work, flush);
+		optind = argc;
+	}
+
+	for (int i = optind ; i < argc && !(limit > 0 && idx >= limit) ; i++) {
 		/******************************************
 		 * initialize
 		 ******************************************/
@@ -523,44 +1293,144 @@ int main (int argc, char **argv)
 
 		Estrdup(input, argv[i]);
 		if (( pin = fopen ( input , "r")) != NULL ) {
+			setoffset(0);
+			useskip = useblk = resync = OFF;
+
+			/*
+			 * a cache made by "-c" is read instead of the log
+			*/
+			if (iscache(pin)) {
+				reader = getcache;
+			}
+			else {
+				reader = getlog;
+				if (skflag && skip_begin(input)) {
+					useskip = ON;
+				}
+				else if (sample_begin(input)) {
+					useblk = ON;
+				}
+				else if (urflag && ur_start(input) >= 0) {
+					reader = getring;
+				}
+				if (cflag) {
+					cache_file(input);
+				}
+			}
+
+			/*
+			 * the receivers of a long "dst:[" line are streamed,
+			 * unless the cache or the skip index needs the line
+			*/
+			shead = &log;
+			setsink(reader == getlog && stage == STAGE_ALL
+				&& !cflag && !skflag ? put_stream : NULL);
 
 			/******************************************
 			 * main
 			 ******************************************
 			 */
 			/*unsigned long int line = 0; obsoleted */
-			for (; (ibuff = getlog(pin)) != NULL; ) {
-				/* fprintf(stderr, "%lu %s\n", ++line, ibuff); obsoleted */
-				if ((rt = decide(ibuff, &log, &opt)) == WRITE) {
-					fprintf(pout, "%s\n", ibuff);
+			for (;;) {
+				/*
+				 * blocks which can not match are not read
+				*/
+				if (useskip && (next = skip_next(getnext())) != getnext()) {
+					if (fseeko(pin, next, SEEK_SET) != 0) {
+						break;
+					}
+					setoffset(next);
 				}
-				else if (rt == OPEN) {
-					snprintf(output, osize, "%s%lu",
-							 out_prefix, ++out_suffix);
-					Fopen(pout, output, "w");
-					print_env(pout, &log);
+				if ((ibuff = reader(pin)) == NULL) {
+					break;
 				}
-				else if (rt == CLOSE) {
-					//freeall(&log);
-					log.write = NOOP;
-					Fclose(pout);
+
+				/*
+				 * "--sample-blocks": a message starting in a block
+				 * out of the sample is not read, nor the lines up to
+				 * the next "src:[" after the jump
+				*/
+				if (useblk && !strncmp(ibuff, STR_SRC, strlen(STR_SRC))) {
+					if ((next = sample_next(getoffset())) != getoffset()) {
+						if (fseeko(pin, next, SEEK_SET) != 0) {
+							break;
+						}
+						setoffset(next);
+						resync = ON;
+						continue;
+					}
+					resync = OFF;
+				}
+				if (resync) {
+					continue;
+				}
+
+				/*
+				 * "--limit": the last message is complete
+				*/
+				if (limit > 0 && idx >= limit
+				    && !strncmp(ibuff, STR_SRC, strlen(STR_SRC))) {
+					break;
 				}
-				else {	/* NOOP */
+				if (reader == getcache && (name = cachename()) != NULL) {
+					Efree(input);
+					Estrdup(input, name);
+					if (cflag) {
+						cache_file(input);
+					}
+				}
+				if (cflag) {
+					cache_put(ibuff, getlength());
+				}
+				if (stage != STAGE_ALL) {
 					continue;
 				}
+				if (skflag) {
+					skip_line(ibuff);
+				}
+				process(ibuff, &log, &opt);
 			}
+			if (skflag) {
+				skip_end();
+			}
+			sample_end();
+			setsink(NULL);
 
 			Fclose(pin);
 		}
 	}
-		/*
+	if (xflag) {
+		exp_close();
+	}
+	if (cflag) {
+		cache_close();
+	}
+	if (aflag) {
+		arc_close();
+	}
+	if (urflag) {
+		ur_close();
+	}
+	if ((mrate < 1.0 || brate < 1.0) && stage == STAGE_ALL
+	    && !(limit > 0 && idx >= limit)) {
+		fprintf(stdout, "Estimate: %.0f\n", sample_estimate(idx));
+	}
+
+	/*
 	* get time
 	*/
 	if (gettimeofday(&etp, NULL)) {
 		sys_err(" gettimeofday failure", SOURCE, __LINE__, 0);
 	}
         else {
-		print_time(&stp, &etp);
+		print_time(&stp, &etp, st_now() - mstp);
+	}
+
+	if (stflag) {
+		st_print(pstat, st_now() - mstp);
+		if (pstat != stderr) {
+			Fclose(pstat);
+		}
 	}
 
 	return 0;
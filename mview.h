@@ -36,7 +36,11 @@
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <strings.h>
+#include <time.h>
+#include <sys/types.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <getopt.h>
@@ -137,6 +141,141 @@ if (fgets(buf, size, file) < 0) { \
 #define	OFFSET(type, field) \
 	((unsigned int)&(((type *)NULL)->field))
 
+/*
+ * state kept per thread, see pipe.c
+*/
+#define THREAD		__thread
+
+/*
+ * statistics, see stats.c
+*/
+#define ST_ADD(field, n) \
+if (stflag) { \
+	st.field += (n); \
+}
+
+#define ST_BEGIN(t) \
+if (stflag) { \
+	t = st_now(); \
+}
+
+#define ST_END(ph, t) \
+if (stflag) { \
+	st.ns[ph] += st_now() - t; \
+}
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _addr {
+	char address[256];
+	struct _addr *next;
+} Addr;
+
+typedef struct _header {
+	char sender[256];
+	struct _addr *next;
+	char *date;
+	int write;
+	off_t offset;		/* offset of "src:[" line in the input */
+	unsigned long size;	/* value of "Size:" line */
+	int hit;		/* matched by the options */
+	int (*match)(struct _header *, struct _header *);
+				/* of the options, see pick() in mview.c */
+	int nrcpt;		/* receivers, see rcpt.c */
+	struct _addr *tail;	/* last one in "next" */
+	FILE *spill;		/* the ones past ADDR_KEEP */
+} Header;
+
+/*
+ * reading the receivers of a Header back (rcpt.c)
+*/
+typedef struct _rcpt {
+	Header *h;
+	Addr *a;
+	int i;
+	char buf[256];
+} Rcpt;
+
+/*
+ * growable byte buffer (misc.c)
+*/
+typedef struct _buf {
+	char *data;
+	size_t len;
+	size_t size;
+} Buf;
+
+/*
+ * statistics (stats.c)
+*/
+enum {
+	PH_READ		= 0,	/* getlog() reading */
+	PH_SPLIT	= 1,	/* splitting the envelope lines */
+	PH_MATCH	= 2,	/* match() */
+	PH_PRINT	= 3,	/* formatting to stdout */
+	PH_DUMP		= 4,	/* writing down messages */
+	NPHASE		= 5
+};
+
+typedef struct _stats {
+	uint64_t bytes;
+	uint64_t lines;
+	uint64_t messages;
+	uint64_t matches;
+	uint64_t dumps;
+	uint64_t skipped;	/* bytes skipped by the skip index or sampling */
+	uint64_t grow_line;	/* Realloc of the line buffers */
+	uint64_t grow_field;	/* Realloc of the field array */
+	uint64_t line_size;	/* largest size of the line buffers */
+	uint64_t field_size;	/* largest size of the field array */
+	uint64_t shrink;	/* buffers given back after a long line */
+	uint64_t ns[NPHASE];
+} Stats;
+
+/*
+ * a whole message, from "src:[" up to the next one
+*/
+typedef struct _msg {
+	Buf text;		/* lines terminated by NEWLINE */
+	char date[64];		/* value of "date:[" */
+	char *name;		/* input file name */
+	off_t offset;		/* offset of the message in the input */
+} Msg;
+
+/*
+ * a run of whole messages in the pipeline (pipe.c)
+*/
+typedef struct _batch {
+	Buf in;			/* lines as read */
+	Buf out;		/* lines to print out, without the index */
+	Buf dump;		/* messages to write down, each after its length */
+	char *mem;		/* message being written down */
+	size_t msize;		/* size of "mem" */
+	char *name;		/* input file name */
+	off_t offset;		/* offset of "in" in the input */
+	int done;		/* set by the worker */
+} Batch;
+
+/*
+ * a query to the daemon (daemon.c)
+*/
+typedef struct _query {
+	Header opt;		/* "-s", "-r", "-d" and "-o" of the client */
+	Header log;		/* envelope data being read */
+	int count;		/* count only */
+	Batch res;		/* lines and messages of the chunk */
+	FILE *line;		/* into "res.out" while a chunk is served */
+	char *lbuf;
+	size_t lsize;
+	FILE *pout;		/* message being written down */
+	unsigned long matches;
+	int fd;			/* of the client, -1 if gone */
+	char *file;
+	struct _query *next;
+} Query;
+
 /********************************************
 * function
 ********************************************
@@ -144,9 +283,132 @@ if (fgets(buf, size, file) < 0) { \
 
 extern int sys_err(const char *, const char *, long int, int);
 
+extern int stflag;
+extern THREAD Stats st;
+extern uint64_t st_now(void);
+extern void st_merge(void);
+extern void st_print(FILE *, uint64_t);
+
 extern char *getlog(FILE *);
 extern char *getfield(int , int);
 extern int getnfield(int);
 extern void setnfield(int , int);
+extern char *putlog(const char *, size_t);
+extern char *setlog(const char *, size_t);
+extern void putfield(int, char *);
+extern size_t getlength(void);
+extern char *getlowered(void);
+extern off_t getoffset(void);
+extern off_t getnext(void);
+extern void setoffset(off_t);
+extern void setsplit(int);
+extern void setsink(void (*)(const char *, int));
+extern int getnstream(void);
+extern time_t getepoch(const char *);
+
+extern void bufput(Buf *, const void *, size_t);
+extern void bufvarint(Buf *, uint64_t);
+extern void buffree(Buf *);
+extern uint64_t getvarint(const unsigned char **);
+extern uint64_t strhash(const char *, size_t);
+
+/*
+ * receivers of a message (rcpt.c)
+*/
+extern void rcpt_clear(Header *);
+extern void rcpt_add(Header *, const char *);
+extern const char *rcpt_first(Header *, Rcpt *);
+extern const char *rcpt_next(Rcpt *);
+extern void rcpt_free(Header *);
+
+/*
+ * columnar envelope export (export.c)
+*/
+extern void exp_open(const char *);
+extern void exp_put(const char *, Header *);
+extern void exp_close(void);
+
+/*
+ * precompacted cache of a log (cache.c)
+*/
+extern void cache_open(const char *, int);
+extern void cache_file(const char *);
+extern void cache_put(const char *, size_t);
+extern void cache_close(void);
+extern int iscache(FILE *);
+extern char *getcache(FILE *);
+extern char *cachename(void);
+
+/*
+ * block-compressed dump archive (archive.c)
+*/
+extern void arc_open(const char *, int);
+extern FILE *arc_begin(void);
+extern void arc_end(FILE *);
+extern void arc_close(void);
+extern int arc_extract(const char *, unsigned long, FILE *);
+
+/*
+ * k-way merge of inputs by date (merge.c)
+*/
+extern void merge_open(char **, int, int);
+extern Msg *merge_next(void);
+extern void merge_close(void);
+
+/*
+ * duplicate detection (dedup.c)
+*/
+extern void dedup_open(long, size_t, int);
+extern int dedup_seen(Msg *);
+extern unsigned long dedup_close(void);
+
+/*
+ * pipelined reader, workers and output (pipe.c)
+*/
+extern void pipe_run(char **, int, int, void (*)(Batch *), void (*)(Batch *));
+
+/*
+ * io_uring read and write path (uring.c)
+*/
+extern int ur_open(void);
+extern int ur_start(const char *);
+extern ssize_t ur_next(const char **);
+extern char *getring(FILE *);
+extern void ur_dump(const char *, char *, size_t);
+extern void ur_close(void);
+
+/*
+ * regular expressions on the addresses (regex.c)
+*/
+extern int re_add(int, const char *);
+extern int re_count(int);
+extern int re_match(int, const char *);
+extern const char *re_error(void);
+
+/*
+ * block skip index (skip.c)
+*/
+extern void skip_query(const char *, const char *, const char *);
+extern int skip_begin(const char *);
+extern off_t skip_tail(void);
+extern off_t skip_next(off_t);
+extern void skip_line(const char *);
+extern void skip_end(void);
+
+/*
+ * sampling of messages and blocks (sample.c)
+*/
+extern void sample_open(double, double);
+extern int sample_msg(Header *);
+extern int sample_begin(const char *);
+extern off_t sample_next(off_t);
+extern void sample_end(void);
+extern double sample_estimate(unsigned long);
+
+/*
+ * query daemon over a unix socket (daemon.c)
+*/
+extern int daemon_run(const char *, void (*)(Batch *, Query **, int));
+extern int client_run(const char *, char **, int, Header *, const char *, int);
 
 /* end of header */
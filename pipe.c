@@ -0,0 +1,442 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  pipe.c
+#contents :  pipe_run()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : misc.c, uring.c, pthread
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  pipelined reader/worker/writer stages
+#update  :  2026/10/19  look for "src:[" only in the bytes read last
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * one reader thread cuts the inputs into batches of whole messages
+ * (a batch ends just before a "src:[" line), "nworker" threads run
+ * work() on them and the calling thread runs output() on them in
+ * the order they were read.
+ *
+ *   reader --(work queue)--> workers --(done flag)--+
+ *     |                                             v
+ *     +-------------(order queue)-------------> output --(free queue)--> reader
+ *
+ * the queues are bounded lock-free rings (D. Vyukov's MPMC queue).
+ * there are "npool" batches only, so the reader waits on the free
+ * queue when the output stage falls behind.
+ *
+ * only read(2) (or the ring of uring.c for regular files) is used
+ * on the inputs, so pipes work as well.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"pipe.c"
+
+#define BATCH_SIZE	(1024 * 1024)
+#define READ_SIZE	(256 * 1024)
+#define MAX_WORKER	64
+#define SPIN		64
+
+#define LOAD(p)		__atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE(p, v)	__atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define CAS(p, o, n)	__atomic_compare_exchange_n(p, o, n, 1, \
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _cell {
+	size_t seq;
+	void *data;
+} Cell;
+
+typedef struct _queue {
+	Cell *cell;
+	size_t mask;
+	size_t enq __attribute__((aligned(64)));
+	size_t deq __attribute__((aligned(64)));
+} Queue;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static Queue qwork;	/* reader -> workers */
+static Queue qorder;	/* reader -> output */
+static Queue qfree;	/* output -> reader */
+
+static Batch *pool	= NULL;
+static int npool	= 0;
+static int nworker	= 0;
+static char **files	= NULL;
+static int nfile	= 0;
+static void (*work)(Batch *)	= NULL;
+
+static Batch last;	/* end of the inputs */
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void pipe_run(char **, int, int, void (*)(Batch *), void (*)(Batch *));
+static void qinit(Queue *, size_t);
+static int qpush(Queue *, void *);
+static void *qpop(Queue *);
+static void push(Queue *, void *);
+static void *pop(Queue *);
+static void backoff(int *);
+static void *reader(void *);
+static void *worker(void *);
+
+
+/********************************************
+ * queue
+ ********************************************
+*/
+void qinit (Queue *q, size_t n)
+{
+	size_t size;
+
+	for (size = 2; size < n; size *= 2)
+		;
+	Calloc(q->cell, size, sizeof(Cell));
+	for (size_t i = 0; i < size; i++) {
+		q->cell[i].seq = i;
+	}
+	q->mask = size - 1;
+	q->enq = q->deq = 0;
+}
+
+int qpush (Queue *q, void *data)
+{
+	Cell *c;
+	size_t pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+	intptr_t dif;
+
+	for (;;) {
+		c = &q->cell[pos & q->mask];
+		dif = (intptr_t)LOAD(&c->seq) - (intptr_t)pos;
+		if (dif == 0) {
+			if (CAS(&q->enq, &pos, pos + 1)) {
+				break;
+			}
+		}
+		else if (dif < 0) {
+			return 0;	/* full */
+		}
+		else {
+			pos = __atomic_load_n(&q->enq, __ATOMIC_RELAXED);
+		}
+	}
+	c->data = data;
+	STORE(&c->seq, pos + 1);
+
+	return 1;
+}
+
+void *qpop (Queue *q)
+{
+	Cell *c;
+	size_t pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED);
+	intptr_t dif;
+	void *data;
+
+	for (;;) {
+		c = &q->cell[pos & q->mask];
+		dif = (intptr_t)LOAD(&c->seq) - (intptr_t)(pos + 1);
+		if (dif == 0) {
+			if (CAS(&q->deq, &pos, pos + 1)) {
+				break;
+			}
+		}
+		else if (dif < 0) {
+			return NULL;	/* empty */
+		}
+		else {
+			pos = __atomic_load_n(&q->deq, __ATOMIC_RELAXED);
+		}
+	}
+	data = c->data;
+	STORE(&c->seq, pos + q->mask + 1);
+
+	return data;
+}
+
+/********************************************
+ * wait a little
+ ********************************************
+*/
+void backoff (int *n)
+{
+	struct timespec t = {0, 50000};
+
+	if (++*n < SPIN) {
+		sched_yield();
+	}
+	else {
+		nanosleep(&t, NULL);
+	}
+}
+
+void push (Queue *q, void *data)
+{
+	for (int n = 0; !qpush(q, data); ) {
+		backoff(&n);
+	}
+}
+
+void *pop (Queue *q)
+{
+	void *data;
+
+	for (int n = 0; (data = qpop(q)) == NULL; ) {
+		backoff(&n);
+	}
+
+	return data;
+}
+
+/********************************************
+ * reader thread
+ ********************************************
+*/
+void *reader (void *arg)
+{
+	Batch *b;
+	Batch *next;
+	char *p;
+	const char *q;
+	ssize_t n;
+	size_t cut;
+	size_t scan;	/* no "src:[" line starts after NEWLINE up to it */
+	off_t off;
+	int fd;
+	int ring;	/* read by ur_next() */
+
+	for (int i = 0; i < nfile; i++) {
+		ring = (fd = ur_start(files[i])) >= 0;
+		if (!ring && (fd = open(files[i], O_RDONLY)) < 0) {
+			sys_err(" ***error*** file open failure", SOURCE, __LINE__, 0);
+			continue;
+		}
+
+		off = 0;
+		b = pop(&qfree);
+		b->name = files[i];
+		b->offset = 0;
+		scan = 0;
+
+		for (;;) {
+			if (ring) {
+				n = ur_next(&q);
+				bufput(&b->in, q, n);
+			}
+			else {
+				if (b->in.size < b->in.len + READ_SIZE) {
+					b->in.size = b->in.len + READ_SIZE;
+					Realloc(b->in.data, b->in.size);
+				}
+				if ((n = read(fd, b->in.data + b->in.len, READ_SIZE)) < 0) {
+					sys_err(" ***error*** read failure", SOURCE, __LINE__, 0);
+					break;
+				}
+				b->in.len += n;
+			}
+			if (n > 0 && b->in.len < BATCH_SIZE) {
+				continue;
+			}
+			if (n == 0) {
+				break;
+			}
+
+			/*
+			 * cut before the last "src:[" line, unless it is the
+			 * first line (one message is larger than a batch).
+			 * the bytes looked at already are not again.
+			*/
+			cut = 0;
+			for (p = b->in.data + b->in.len - 1; p > b->in.data + scan; p--) {
+				if (*p == NEWLINE
+				    && b->in.data + b->in.len - p > STR_SRC_LENGTH - 1
+				    && !strncmp(p + 1, STR_SRC, strlen(STR_SRC))) {
+					cut = p + 1 - b->in.data;
+					break;
+				}
+			}
+			if (cut == 0) {
+				scan = b->in.len > STR_SRC_LENGTH
+					? b->in.len - STR_SRC_LENGTH : 0;
+				continue;
+			}
+			scan = 0;
+
+			next = pop(&qfree);
+			next->name = files[i];
+			off += cut;
+			next->offset = off;
+			bufput(&next->in, b->in.data + cut, b->in.len - cut);
+			b->in.len = cut;
+
+			push(&qorder, b);
+			push(&qwork, b);
+			b = next;
+		}
+		if (!ring) {
+			close(fd);
+		}
+
+		if (b->in.len > 0) {
+			if (b->in.data[b->in.len - 1] != NEWLINE) {
+				bufput(&b->in, "\n", 1);
+			}
+			push(&qorder, b);
+			push(&qwork, b);
+		}
+		else {
+			push(&qfree, b);
+		}
+	}
+
+	push(&qorder, &last);
+	for (int i = 0; i < nworker; i++) {
+		push(&qwork, &last);
+	}
+	st_merge();
+
+	return arg;
+}
+
+/********************************************
+ * worker thread
+ ********************************************
+*/
+void *worker (void *arg)
+{
+	Batch *b;
+
+	while ((b = pop(&qwork)) != &last) {
+		work(b);
+		STORE(&b->done, 1);
+	}
+	st_merge();
+
+	return arg;
+}
+
+/********************************************
+ * run pipeline
+ ********************************************
+*/
+void pipe_run (char **f, int n, int threads,
+	       void (*w)(Batch *), void (*output)(Batch *))
+{
+	pthread_t rt;
+	pthread_t wt[MAX_WORKER];
+	Batch *b;
+
+	files = f;
+	nfile = n;
+	work = w;
+	nworker = threads < 1 ? 1 : (threads > MAX_WORKER ? MAX_WORKER : threads);
+	npool = nworker * 2 + 2;
+
+	qinit(&qwork, npool + nworker);
+	qinit(&qorder, npool + 1);
+	qinit(&qfree, npool);
+	Calloc(pool, npool, sizeof(Batch));
+	for (int i = 0; i < npool; i++) {
+		push(&qfree, &pool[i]);
+	}
+
+	if (pthread_create(&rt, NULL, reader, NULL)) {
+		sys_err(" ***error*** pthread_create failure", SOURCE, __LINE__, 0);
+		exit(1);
+	}
+	for (int i = 0; i < nworker; i++) {
+		if (pthread_create(&wt[i], NULL, worker, NULL)) {
+			sys_err(" ***error*** pthread_create failure", SOURCE, __LINE__, 0);
+			exit(1);
+		}
+	}
+
+	/*
+	 * output stage, in order of reading
+	*/
+	while ((b = pop(&qorder)) != &last) {
+		for (int n = 0; !LOAD(&b->done); ) {
+			backoff(&n);
+		}
+		output(b);
+		b->in.len = b->out.len = b->dump.len = 0;
+		b->done = 0;
+		push(&qfree, b);
+	}
+
+	pthread_join(rt, NULL);
+	for (int i = 0; i < nworker; i++) {
+		pthread_join(wt[i], NULL);
+	}
+
+	for (int i = 0; i < npool; i++) {
+		buffree(&pool[i].in);
+		buffree(&pool[i].out);
+		buffree(&pool[i].dump);
+	}
+	Efree(pool);
+	Efree(qwork.cell);
+	Efree(qorder.cell);
+	Efree(qfree.cell);
+}
+
+/* end of source */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  rcpt.c
+#contents :  rcpt_clear(), rcpt_add(), rcpt_first(), rcpt_next(), rcpt_free()
+#version  :  1.00
+#higher module : mview.c, export.c, sample.c, daemon.c
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  receivers of a message, spilled past ADDR_KEEP
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * the receivers of the message being read. the first ADDR_KEEP are
+ * kept in the Addr list of the Header, the others are written to a
+ * temporary file ("spill") as NUL terminated strings, so a bulk mail
+ * takes no more memory than a message of ADDR_KEEP receivers. they
+ * are read back in order by rcpt_first() and rcpt_next():
+ *
+ *   Rcpt r;
+ *   for (p = rcpt_first(l, &r); p != NULL; p = rcpt_next(&r))
+ *       ...
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"rcpt.c"
+
+#define ADDR_KEEP	1024	/* receivers kept in memory */
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void rcpt_clear(Header *);
+void rcpt_add(Header *, const char *);
+const char *rcpt_first(Header *, Rcpt *);
+const char *rcpt_next(Rcpt *);
+void rcpt_free(Header *);
+
+
+/********************************************
+ * clear the receivers
+ ********************************************
+*/
+void rcpt_clear (Header *h)
+{
+	h->nrcpt = 0;
+	h->tail = NULL;
+}
+
+/********************************************
+ * add a receiver
+ ********************************************
+ *
+ * "p" is shorter than the address of Addr, see decide() in mview.c.
+ *
+*/
+void rcpt_add (Header *h, const char *p)
+{
+	Addr *a;
+
+	if (h->nrcpt < ADDR_KEEP) {
+		if (h->next == NULL) {
+			Emalloc(h->next, sizeof(Addr));
+		}
+		if (h->tail == NULL) {
+			a = h->next;
+		}
+		else {
+			if (h->tail->next == NULL) {
+				Emalloc(h->tail->next, sizeof(Addr));
+			}
+			a = h->tail->next;
+		}
+		strncpy(a->address, p, sizeof(a->address) - 1);
+		a->address[sizeof(a->address) - 1] = '\0';
+		h->tail = a;
+		h->nrcpt++;
+		return;
+	}
+
+	if (h->spill == NULL && (h->spill = tmpfile()) == NULL) {
+		sys_err(" ***error*** can not make the spill file", SOURCE, __LINE__, 1);
+	}
+	if (h->nrcpt == ADDR_KEEP) {
+		fseeko(h->spill, 0, SEEK_SET);
+	}
+	if (fputs(p, h->spill) == EOF || putc('\0', h->spill) == EOF) {
+		sys_err(" ***error*** spill file write failure", SOURCE, __LINE__, 1);
+	}
+	h->nrcpt++;
+}
+
+/********************************************
+ * read the receivers back
+ ********************************************
+*/
+const char *rcpt_first (Header *h, Rcpt *r)
+{
+	r->h = h;
+	r->a = h->next;
+	r->i = 0;
+	if (h->nrcpt > ADDR_KEEP) {
+		fflush(h->spill);
+		fseeko(h->spill, 0, SEEK_SET);
+	}
+
+	return rcpt_next(r);
+}
+
+const char *rcpt_next (Rcpt *r)
+{
+	const char *p;
+	int c;
+	size_t n;
+
+	if (r->i >= r->h->nrcpt) {
+		return NULL;
+	}
+	if (r->i++ < ADDR_KEEP) {
+		p = r->a->address;
+		r->a = r->a->next;
+		return p;
+	}
+
+	for (n = 0; (c = getc(r->h->spill)) != EOF && c != '\0'; ) {
+		if (n < sizeof(r->buf) - 1) {
+			r->buf[n++] = c;
+		}
+	}
+	r->buf[n] = '\0';
+
+	return r->buf;
+}
+
+/********************************************
+ * free the receivers
+ ********************************************
+*/
+void rcpt_free (Header *h)
+{
+	Addr *a;
+
+	while ((a = h->next) != NULL) {
+		h->next = a->next;
+		Efree(a);
+	}
+	if (h->spill != NULL) {
+		fclose(h->spill);
+		h->spill = NULL;
+	}
+	rcpt_clear(h);
+}
+
+/* end of source */
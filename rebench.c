@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  rebench.c
+#contents :  compare the DFA of regex.c with regexec() pattern by pattern
+#version  :  1.00
+#higher module : Makefile (bench-re, test-re)
+#lower  module : regex.c, getlog.c, regex(3)
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  regex benchmark
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <regex.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"rebench.c"
+
+
+/********************************************
+ * main routine
+ ********************************************
+ *
+ * usage: rebench log pattern...
+ *
+ * the addresses of "src:[" and "dst:[" lines of the log are matched
+ * against the patterns, by the DFA at once and by regexec() one
+ * pattern after another until one matches. both have to match the
+ * same addresses, the exit status is 1 otherwise.
+ *
+*/
+int main (int argc, char **argv)
+{
+	FILE *in;
+	char *p;
+	char **addr = NULL;
+	size_t naddr = 0;
+	regex_t *re;
+	int npat;
+	unsigned long hit[2] = {0, 0};
+	unsigned long diff = 0;
+	char *res;
+	uint64_t t[3];
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: rebench log pattern...\n");
+		exit(1);
+	}
+	npat = argc - 2;
+
+	Fopen(in, argv[1], "r");
+	if (in == NULL) {
+		exit(1);
+	}
+	while ((p = getlog(in)) != NULL) {
+		int type = !strncmp(p, STR_SRC, strlen(STR_SRC)) ? FROM
+			: (!strncmp(p, STR_DST, strlen(STR_DST)) ? TO : -1);
+
+		if (type < 0) {
+			continue;
+		}
+		for (int i = 0; i < getnfield(type); i++) {
+			if ((naddr & (naddr - 1)) == 0) {
+				Realloc(addr, (naddr ? naddr * 2 : 1) * sizeof(char *));
+			}
+			Estrdup(addr[naddr], getfield(i, type));
+			naddr++;
+		}
+	}
+	Fclose(in);
+
+	Calloc(re, npat, sizeof(regex_t));
+	Calloc(res, naddr + 1, 1);
+	for (int i = 0; i < npat; i++) {
+		if (re_add(FROM, argv[i + 2]) < 0) {
+			fprintf(stderr, "rebench: %s: %s\n", argv[i + 2], re_error());
+			exit(1);
+		}
+		if (regcomp(&re[i], argv[i + 2], REG_EXTENDED | REG_NOSUB)) {
+			fprintf(stderr, "rebench: %s: regcomp failure\n", argv[i + 2]);
+			exit(1);
+		}
+	}
+
+	t[0] = st_now();
+	for (size_t k = 0; k < naddr; k++) {
+		res[k] = re_match(FROM, addr[k]);
+		hit[0] += res[k];
+	}
+	t[1] = st_now();
+	for (size_t k = 0; k < naddr; k++) {
+		int m = 0;
+
+		for (int i = 0; i < npat && !m; i++) {
+			m = regexec(&re[i], addr[k], 0, NULL, 0) == 0;
+		}
+		hit[1] += m;
+		diff += m != res[k];
+	}
+	t[2] = st_now();
+
+	fprintf(stdout, "%d patterns, %lu addresses\n", npat, (unsigned long)naddr);
+	fprintf(stdout, "  dfa      %8lu matches %10.3f ms\n",
+		hit[0], (t[1] - t[0]) / 1e6);
+	fprintf(stdout, "  regexec  %8lu matches %10.3f ms\n",
+		hit[1], (t[2] - t[1]) / 1e6);
+	fprintf(stdout, "  speedup  %8.1fx\n",
+		(double)(t[2] - t[1]) / (t[1] - t[0] ? t[1] - t[0] : 1));
+	if (diff) {
+		fprintf(stdout, "  %lu addresses differ\n", diff);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* end of source */
@@ -0,0 +1,736 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  regex.c
+#contents :  re_add(), re_count(), re_match(), re_error()
+#version  :  1.00
+#higher module : mview.c, rebench.c
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  regular expressions on the addresses
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * the patterns of one kind (FROM or TO) are parsed into trees,
+ * compiled together into one Thompson NFA, one alternative per
+ * pattern, and searched by a DFA built lazily from the NFA: a DFA
+ * state is a set of NFA states and its transitions are made on first
+ * use. an address is scanned once whatever the number of patterns.
+ *
+ * syntax (POSIX extended like):
+ *   c  .  [abc]  [^a-z]  \. \d \w \s  (...)  a|b
+ *   *  +  ?  {n}  {n,}  {n,m}  ^  $
+ *
+ * the search is not anchored, unless by "^". "$" consumes the end of
+ * the address, a symbol of its own. the NFA is shared and read only
+ * once built, each thread has its own DFA states.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"regex.c"
+
+#define END		256		/* symbol at the end */
+#define NSYM		257
+#define MAX_NFA		(1 << 16)	/* states of a kind */
+#define MAX_REPEAT	1000
+#define MAX_DFA		1024		/* states cached, then flushed */
+
+#define ISSET(s, c)	((s)[(c) >> 5] & (1U << ((c) & 31)))
+#define SET(s, c)	((s)[(c) >> 5] |= (1U << ((c) & 31)))
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+enum {
+	N_SET		= 0,	/* one byte of the set */
+	N_CAT		= 1,
+	N_ALT		= 2,
+	N_REP		= 3,
+	N_BOL		= 4,	/* ^ */
+	N_EOL		= 5,	/* $ */
+	N_EMPTY		= 6
+};
+
+typedef struct _node {
+	int type;
+	uint32_t set[8];
+	int min;
+	int max;		/* -1 for no limit */
+	struct _node *l;
+	struct _node *r;
+} Node;
+
+enum {
+	S_CHAR		= 0,	/* consumes a byte of "set" */
+	S_END		= 1,	/* consumes END */
+	S_SPLIT		= 2,
+	S_BOL		= 3,	/* passed at the beginning only */
+	S_MATCH		= 4
+};
+
+typedef struct _state {
+	int type;
+	int out;
+	int out1;
+	uint32_t set[8];
+} State;
+
+typedef struct _nfa {
+	Node **tree;		/* patterns */
+	int ntree;
+	State *state;
+	int nstate;
+	int start;
+} Nfa;
+
+typedef struct _dstate {
+	int *set;		/* sorted NFA states */
+	int n;
+	int accept;
+	uint64_t hash;
+	int next[NSYM];		/* -1 if not made yet */
+} Dstate;
+
+typedef struct _dfa {
+	Dstate **state;
+	int nstate;
+	int *table;		/* open addressing, index + 1 */
+	int tsize;
+	int start;		/* -1 if not made yet */
+	int *mark;		/* of the closure */
+	int gen;
+	int *stack;
+	int *list;
+	int built;		/* patterns of the NFA seen */
+} Dfa;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static Nfa nfa[2];		/* FROM and TO */
+static THREAD Dfa dfa[2];
+
+static const char *errmsg = NULL;
+static const char *pp;		/* pattern being parsed */
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+int re_add(int, const char *);
+int re_count(int);
+int re_match(int, const char *);
+const char *re_error(void);
+
+static Node *node(int, Node *, Node *);
+static Node *alt(void);
+static Node *concat(void);
+static Node *repeat(void);
+static Node *atom(void);
+static int klass(uint32_t *);
+static int escape(uint32_t *, int);
+static int number(void);
+static int newstate(Nfa *, int, int, int);
+static int emit(Nfa *, Node *, int);
+static void dfa_reset(Dfa *);
+static void closure(Nfa *, Dfa *, int, int, int *);
+static int cmpint(const void *, const void *);
+static int intern(Nfa *, Dfa *, int *, int);
+static int step(Nfa *, Dfa *, int, int);
+
+
+/********************************************
+ * parser
+ ********************************************
+*/
+Node *node (int type, Node *l, Node *r)
+{
+	Node *n;
+
+	Emalloc(n, sizeof(Node));
+	n->type = type;
+	n->l = l;
+	n->r = r;
+
+	return n;
+}
+
+Node *alt (void)
+{
+	Node *n = concat();
+
+	while (n != NULL && *pp == '|') {
+		pp++;
+		n = node(N_ALT, n, concat());
+		if (n->r == NULL) {
+			return NULL;
+		}
+	}
+
+	return n;
+}
+
+Node *concat (void)
+{
+	Node *n = node(N_EMPTY, NULL, NULL);
+	Node *r;
+
+	while (*pp != '\0' && *pp != '|' && *pp != ')') {
+		if ((r = repeat()) == NULL) {
+			return NULL;
+		}
+		n = node(N_CAT, n, r);
+	}
+
+	return n;
+}
+
+Node *repeat (void)
+{
+	Node *n = atom();
+	Node *r;
+
+	while (n != NULL) {
+		if (*pp == '*' || *pp == '+' || *pp == '?') {
+			r = node(N_REP, n, NULL);
+			r->min = *pp == '+';
+			r->max = *pp == '?' ? 1 : -1;
+			pp++;
+		}
+		else if (*pp == '{' && isdigit((unsigned char)pp[1])) {
+			pp++;
+			r = node(N_REP, n, NULL);
+			r->min = r->max = number();
+			if (*pp == ',') {
+				pp++;
+				r->max = isdigit((unsigned char)*pp) ? number() : -1;
+			}
+			if (*pp != '}' || r->min > MAX_REPEAT || r->max > MAX_REPEAT
+			    || (r->max >= 0 && r->max < r->min)) {
+				errmsg = "bad repetition";
+				return NULL;
+			}
+			pp++;
+		}
+		else {
+			break;
+		}
+		n = r;
+	}
+
+	return n;
+}
+
+Node *atom (void)
+{
+	Node *n;
+	int c = (unsigned char)*pp++;
+
+	switch (c) {
+	case '(':
+		if ((n = alt()) == NULL) {
+			return NULL;
+		}
+		if (*pp++ != ')') {
+			errmsg = "missing )";
+			return NULL;
+		}
+		return n;
+	case '^':
+		return node(N_BOL, NULL, NULL);
+	case '$':
+		return node(N_EOL, NULL, NULL);
+	case '*':
+	case '+':
+	case '?':
+		errmsg = "nothing to repeat";
+		return NULL;
+	}
+
+	n = node(N_SET, NULL, NULL);
+	if (c == '.') {
+		memset(n->set, 0xff, sizeof(n->set));
+	}
+	else if (c == '[') {
+		if (!klass(n->set)) {
+			return NULL;
+		}
+	}
+	else if (c == '\\') {
+		if (!escape(n->set, (unsigned char)*pp++)) {
+			return NULL;
+		}
+	}
+	else {
+		SET(n->set, c);
+	}
+
+	return n;
+}
+
+/*
+ * [...] after "["
+*/
+int klass (uint32_t *set)
+{
+	int neg = 0;
+	int c, e;
+
+	if (*pp == '^') {
+		neg = 1;
+		pp++;
+	}
+	for (int first = 1; *pp != ']' || first; first = 0) {
+		if (*pp == '\0') {
+			errmsg = "missing ]";
+			return 0;
+		}
+		c = (unsigned char)*pp++;
+		if (c == '\\') {
+			if (!escape(set, (unsigned char)*pp++)) {
+				return 0;
+			}
+			continue;
+		}
+		e = c;
+		if (*pp == '-' && pp[1] != ']' && pp[1] != '\0') {
+			e = (unsigned char)pp[1];
+			pp += 2;
+			if (e < c) {
+				errmsg = "bad range";
+				return 0;
+			}
+		}
+		for (; c <= e; c++) {
+			SET(set, c);
+		}
+	}
+	pp++;
+
+	if (neg) {
+		for (int i = 0; i < 8; i++) {
+			set[i] = ~set[i];
+		}
+	}
+
+	return 1;
+}
+
+int escape (uint32_t *set, int c)
+{
+	switch (c) {
+	case '\0':
+		errmsg = "trailing \\";
+		return 0;
+	case 'd':
+		for (c = '0'; c <= '9'; c++) {
+			SET(set, c);
+		}
+		break;
+	case 'w':
+		for (c = 0; c < 256; c++) {
+			if (isalnum(c) || c == '_') {
+				SET(set, c);
+			}
+		}
+		break;
+	case 's':
+		for (c = 0; c < 256; c++) {
+			if (isspace(c)) {
+				SET(set, c);
+			}
+		}
+		break;
+	default:
+		SET(set, c);
+		break;
+	}
+
+	return 1;
+}
+
+int number (void)
+{
+	int n = 0;
+
+	while (isdigit((unsigned char)*pp) && n <= MAX_REPEAT) {
+		n = n * 10 + (*pp++ - '0');
+	}
+
+	return n;
+}
+
+/********************************************
+ * NFA
+ ********************************************
+*/
+int newstate (Nfa *a, int type, int out, int out1)
+{
+	State *s;
+
+	if (a->nstate >= MAX_NFA) {
+		errmsg = "too large";
+		return -1;
+	}
+	if ((a->nstate & (a->nstate - 1)) == 0) {
+		Realloc(a->state, (a->nstate ? a->nstate * 2 : 1) * sizeof(State));
+	}
+	s = &a->state[a->nstate];
+	memset(s, 0, sizeof(State));
+	s->type = type;
+	s->out = out;
+	s->out1 = out1;
+
+	return a->nstate++;
+}
+
+/*
+ * compile "n" to continue at "next", returns the entry
+*/
+int emit (Nfa *a, Node *n, int next)
+{
+	int s, r;
+
+	if (next < 0) {
+		return -1;
+	}
+	switch (n->type) {
+	case N_SET:
+		if ((s = newstate(a, S_CHAR, next, -1)) >= 0) {
+			memcpy(a->state[s].set, n->set, sizeof(n->set));
+		}
+		return s;
+	case N_EOL:
+		return newstate(a, S_END, next, -1);
+	case N_BOL:
+		return newstate(a, S_BOL, next, -1);
+	case N_EMPTY:
+		return next;
+	case N_CAT:
+		return emit(a, n->l, emit(a, n->r, next));
+	case N_ALT:
+		r = emit(a, n->r, next);
+		return newstate(a, S_SPLIT, emit(a, n->l, next), r);
+	case N_REP:
+		r = next;
+		if (n->max < 0) {
+			/* x* loops back to the split */
+			if ((s = newstate(a, S_SPLIT, -1, next)) < 0) {
+				return -1;
+			}
+			r = emit(a, n->l, s);
+			a->state[s].out = r;
+			r = s;
+		}
+		else {
+			/* (x(x)?)? for the optional ones */
+			for (int i = n->min; i < n->max && r >= 0; i++) {
+				r = newstate(a, S_SPLIT, emit(a, n->l, r), next);
+			}
+		}
+		for (int i = 0; i < n->min && r >= 0; i++) {
+			r = emit(a, n->l, r);
+		}
+		return r;
+	}
+
+	return -1;
+}
+
+/********************************************
+ * add a pattern
+ ********************************************
+ *
+ * returns -1 if it is wrong, see re_error().
+ *
+*/
+int re_add (int kind, const char *pattern)
+{
+	Nfa *a = &nfa[kind == FROM ? 0 : 1];
+	Node *n;
+	int s;
+
+	errmsg = NULL;
+	pp = pattern;
+	if ((n = alt()) == NULL || *pp != '\0') {
+		if (errmsg == NULL) {
+			errmsg = "unmatched )";
+		}
+		return -1;
+	}
+
+	Realloc(a->tree, (a->ntree + 1) * sizeof(Node *));
+	a->tree[a->ntree++] = n;
+
+	/*
+	 * compile all again, one alternative per pattern
+	*/
+	a->nstate = 0;
+	s = newstate(a, S_MATCH, -1, -1);
+	a->start = -1;
+	for (int i = 0; i < a->ntree && s >= 0; i++) {
+		a->start = a->start < 0 ? emit(a, a->tree[i], 0)
+			: newstate(a, S_SPLIT, emit(a, a->tree[i], 0), a->start);
+	}
+	if (a->start < 0 || errmsg != NULL) {
+		a->ntree--;
+		return -1;
+	}
+
+	return 0;
+}
+
+int re_count (int kind)
+{
+	return nfa[kind == FROM ? 0 : 1].ntree;
+}
+
+const char *re_error (void)
+{
+	return errmsg ? errmsg : "";
+}
+
+/********************************************
+ * DFA
+ ********************************************
+*/
+void dfa_reset (Dfa *d)
+{
+	for (int i = 0; i < d->nstate; i++) {
+		Efree(d->state[i]->set);
+		Efree(d->state[i]);
+	}
+	d->nstate = 0;
+	d->start = -1;
+	memset(d->table, 0, d->tsize * sizeof(int));
+}
+
+/*
+ * NFA states reached from "s" without consuming, only the ones
+ * consuming and the match are put on the list
+*/
+void closure (Nfa *a, Dfa *d, int s, int bol, int *n)
+{
+	State *p;
+	int sp = 0;
+
+	d->stack[sp++] = s;
+	while (sp > 0) {
+		s = d->stack[--sp];
+		if (s < 0 || d->mark[s] == d->gen) {
+			continue;
+		}
+		d->mark[s] = d->gen;
+		p = &a->state[s];
+		switch (p->type) {
+		case S_SPLIT:
+			d->stack[sp++] = p->out1;
+			d->stack[sp++] = p->out;
+			break;
+		case S_BOL:
+			if (bol) {
+				d->stack[sp++] = p->out;
+			}
+			break;
+		default:
+			d->list[(*n)++] = s;
+			break;
+		}
+	}
+}
+
+int cmpint (const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * DFA state of the set, made if new
+*/
+int intern (Nfa *a, Dfa *d, int *set, int n)
+{
+	Dstate *p;
+	uint64_t h;
+	int i;
+
+	qsort(set, n, sizeof(int), cmpint);
+	h = strhash((const char *)set, n * sizeof(int));
+	for (i = h & (d->tsize - 1); d->table[i]; i = (i + 1) & (d->tsize - 1)) {
+		p = d->state[d->table[i] - 1];
+		if (p->hash == h && p->n == n
+		    && !memcmp(p->set, set, n * sizeof(int))) {
+			return d->table[i] - 1;
+		}
+	}
+
+	Emalloc(p, sizeof(Dstate));
+	Emalloc(p->set, n * sizeof(int) + 1);
+	memcpy(p->set, set, n * sizeof(int));
+	p->n = n;
+	p->hash = h;
+	memset(p->next, 0xff, sizeof(p->next));
+	for (int k = 0; k < n; k++) {
+		if (a->state[set[k]].type == S_MATCH) {
+			p->accept = 1;
+		}
+	}
+	d->state[d->nstate] = p;
+	d->table[i] = ++d->nstate;
+
+	return d->nstate - 1;
+}
+
+/*
+ * transition of state "s" by "c", the start is added again
+ * since the search is not anchored
+*/
+int step (Nfa *a, Dfa *d, int s, int c)
+{
+	Dstate *p = d->state[s];
+	State *q;
+	int n = 0;
+	int t;
+
+	d->gen++;
+	for (int k = 0; k < p->n; k++) {
+		q = &a->state[p->set[k]];
+		if ((q->type == S_CHAR && c != END && ISSET(q->set, c))
+		    || (q->type == S_END && c == END)) {
+			closure(a, d, q->out, 0, &n);
+		}
+	}
+	if (c != END) {
+		closure(a, d, a->start, 0, &n);
+	}
+
+	/*
+	 * too many states, start over
+	*/
+	if (d->nstate >= MAX_DFA) {
+		int *set;
+
+		Emalloc(set, n * sizeof(int) + 1);
+		memcpy(set, d->list, n * sizeof(int));
+		dfa_reset(d);
+		t = intern(a, d, set, n);
+		Efree(set);
+		return t;
+	}
+
+	t = intern(a, d, d->list, n);
+	d->state[s]->next[c] = t;
+
+	return t;
+}
+
+/********************************************
+ * match an address
+ ********************************************
+ *
+ * returns 1 if one of the patterns of the kind matches.
+ *
+*/
+int re_match (int kind, const char *str)
+{
+	Nfa *a = &nfa[kind == FROM ? 0 : 1];
+	Dfa *d = &dfa[kind == FROM ? 0 : 1];
+	const unsigned char *p = (const unsigned char *)str;
+	int s, t;
+	int n = 0;
+
+	if (a->ntree == 0) {
+		return 0;
+	}
+	if (d->built != a->ntree) {
+		/* patterns added since, or first use by this thread */
+		if (d->table != NULL) {
+			dfa_reset(d);
+		}
+		Realloc(d->state, MAX_DFA * sizeof(Dstate *));
+		Realloc(d->mark, a->nstate * sizeof(int));
+		Realloc(d->stack, a->nstate * 2 * sizeof(int) + sizeof(int));
+		Realloc(d->list, a->nstate * sizeof(int));
+		memset(d->mark, 0, a->nstate * sizeof(int));
+		d->tsize = MAX_DFA * 2;
+		Realloc(d->table, d->tsize * sizeof(int));
+		memset(d->table, 0, d->tsize * sizeof(int));
+		d->nstate = 0;
+		d->start = -1;
+		d->gen = 0;
+		d->built = a->ntree;
+	}
+	if (d->start < 0) {
+		d->gen++;
+		closure(a, d, a->start, 1, &n);
+		d->start = intern(a, d, d->list, n);
+	}
+
+	for (s = d->start; ; p++) {
+		if (d->state[s]->accept) {
+			return 1;
+		}
+		if (*p == '\0') {
+			break;
+		}
+		if ((t = d->state[s]->next[*p]) < 0) {
+			t = step(a, d, s, *p);
+		}
+		s = t;
+	}
+	if ((t = d->state[s]->next[END]) < 0) {
+		t = step(a, d, s, END);
+	}
+
+	return d->state[t]->accept;
+}
+
+/* end of source */
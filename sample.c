@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  sample.c
+#contents :  sample_open(), sample_msg(), sample_begin(), sample_next(),
+#            sample_end(), sample_estimate()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : getlog.c, misc.c
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  sampling of messages and blocks
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * two ways to look at a part of the logs only:
+ *
+ *   "--sample=R"         a message is taken when the hash of its
+ *                        envelope (sender, receivers, date) falls in
+ *                        the first R of the range, so the same
+ *                        messages are taken every time. the others are
+ *                        not matched, printed nor written down.
+ *   "--sample-blocks=R"  blocks of SAMPLE_BLOCK bytes of a regular file
+ *                        are taken by the hash of their number, the
+ *                        messages starting in the others are not read.
+ *
+ * the matches are scaled up by both rates for the estimate.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <sys/stat.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"sample.c"
+
+#define SAMPLE_BLOCK	(1024 * 1024)
+#define MIX		0x100000001b3ULL
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static double mrate	= 1.0;	/* of the messages */
+static double brate	= 1.0;	/* of the blocks */
+static off_t fsize	= -1;	/* of the file sampled by blocks */
+static uint64_t total	= 0;	/* bytes of the files */
+static uint64_t taken	= 0;	/* bytes of the blocks taken */
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void sample_open(double, double);
+int sample_msg(Header *);
+int sample_begin(const char *);
+off_t sample_next(off_t);
+void sample_end(void);
+double sample_estimate(unsigned long);
+static int take(uint64_t, double);
+
+
+/********************************************
+ * set the rates
+ ********************************************
+*/
+void sample_open (double m, double b)
+{
+	mrate = m;
+	brate = b;
+}
+
+/*
+ * 1 if the hash is in the first "rate" of the range
+*/
+int take (uint64_t h, double rate)
+{
+	return (h >> 11) * (1.0 / 9007199254740992.0) < rate;
+}
+
+/********************************************
+ * a message
+ ********************************************
+*/
+int sample_msg (Header *l)
+{
+	uint64_t h;
+	Rcpt r;
+	const char *s;
+
+	if (mrate >= 1.0) {
+		return 1;
+	}
+	h = strhash(l->sender, strlen(l->sender));
+	h = (h ^ strhash(l->date, strlen(l->date))) * MIX;
+	for (s = rcpt_first(l, &r); s != NULL; s = rcpt_next(&r)) {
+		h = (h ^ strhash(s, strlen(s))) * MIX;
+	}
+
+	return take(h, mrate);
+}
+
+/********************************************
+ * blocks of a file
+ ********************************************
+ *
+ * returns 1 if the blocks of the file are sampled by sample_next(),
+ * i.e. "--sample-blocks" and a regular file.
+ *
+*/
+int sample_begin (const char *file)
+{
+	struct stat sb;
+
+	fsize = -1;
+	if (brate >= 1.0 || stat(file, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+		return 0;
+	}
+
+	fsize = sb.st_size;
+	total += fsize;
+	for (uint64_t b = 0; b * SAMPLE_BLOCK < fsize; b++) {
+		if (take(strhash((const char *)&b, sizeof(b)), brate)) {
+			taken += fsize - b * SAMPLE_BLOCK < SAMPLE_BLOCK
+				? fsize - b * SAMPLE_BLOCK : SAMPLE_BLOCK;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * "off" is the offset of a "src:[" line. the offset of the first
+ * block taken from there is returned, the end of the file if none.
+*/
+off_t sample_next (off_t off)
+{
+	uint64_t b = off / SAMPLE_BLOCK;
+	off_t to;
+
+	while (b * SAMPLE_BLOCK < fsize
+	       && !take(strhash((const char *)&b, sizeof(b)), brate)) {
+		b++;
+	}
+	if (b == off / SAMPLE_BLOCK) {
+		return off;
+	}
+	to = b * SAMPLE_BLOCK < fsize ? b * SAMPLE_BLOCK : fsize;
+
+	ST_ADD(skipped, to - off);
+
+	return to;
+}
+
+/*
+ * a file read whole counts as taken
+*/
+void sample_end (void)
+{
+	if (fsize < 0) {
+		total += getnext();
+		taken += getnext();
+	}
+	fsize = -1;
+}
+
+/********************************************
+ * estimate
+ ********************************************
+*/
+double sample_estimate (unsigned long matches)
+{
+	double e = matches / mrate;
+
+	if (total > 0) {
+		e = taken ? e * total / taken : 0;
+	}
+
+	return e;
+}
+
+/* end of source */
@@ -0,0 +1,600 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  skip.c
+#contents :  skip_query(), skip_begin(), skip_tail(), skip_next(), skip_line(),
+#            skip_end()
+#version  :  1.00
+#higher module : mview.c
+#lower  module : getlog.c, misc.c
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  block skip index of a log
+#update  :  2026/10/19  incremental maintenance of appended logs
+#update  :  2026/10/19  check the blocks against the number of messages
+#update  :  2026/10/19  check the size of the bloom filters
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * file layout of "log.skip"
+ *
+ *   header  "MVIEWSKP", u32 version, u32 blocks, u64 size, i64 mtime,
+ *           u64 dev, u64 inode, u64 tail, u64 messages,
+ *           u64 hash of the head, u64 hash before the tail
+ *   block   u64 offset, u64 length, u32 bits, u32 messages,
+ *           char min[32], char max[32], bloom filter of "bits" bits
+ *   ...
+ *
+ * a block is about SKIP_BLOCK bytes of whole messages, it starts at a
+ * "src:[" line. "min" and "max" are the smallest and largest "date:["
+ * of the block. the bloom filter holds the addresses of "src:[" and
+ * "dst:[" (told apart), each by its prefixes of PREFIX lengths and
+ * whole, since the options of match() are prefixes. a query of
+ * length L is looked up by its longest prefix in PREFIX.
+ *
+ * the index is made while a log is read without one, and used by the
+ * next runs as long as the log keeps its size and mtime.
+ *
+ * "tail" is the offset of the last block, which may end with a
+ * message still being written. when the log only grew (same inode,
+ * the HASH_SIZE bytes at the head and before "tail" unchanged), the
+ * blocks before "tail" are kept and the log is summarized again from
+ * there only. otherwise (truncated, rotated) the index is made again.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <sys/stat.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"skip.c"
+
+#define SKIP_MAGIC	"MVIEWSKP"
+#define SKIP_VERSION	2
+#define SKIP_SUFFIX	".skip"
+#define SKIP_BLOCK	(1024 * 1024)
+#define BLOOM_K		4
+#define BLOOM_BITS	8		/* per key */
+#define DATE_MAX	32
+#define HASH_SIZE	4096
+
+
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _block {
+	uint64_t offset;
+	uint64_t length;
+	uint32_t bits;
+	uint32_t messages;
+	char min[DATE_MAX];
+	char max[DATE_MAX];
+	uint8_t *bloom;
+} Block;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static const size_t prefix[] = {4, 8, 16, 32};
+#define NPREFIX		(sizeof(prefix) / sizeof(prefix[0]))
+
+/*
+ * query, the one match() looks at
+*/
+static int qtype	= -1;	/* FROM, TO, DATE or -1 */
+static const char *qstr	= NULL;
+
+static Block *blk	= NULL;
+static uint32_t nblk	= 0;
+static uint32_t cur	= 0;	/* block of the next line */
+static int mode		= 0;	/* S_USE or S_MAKE */
+static off_t tail	= 0;	/* summarized again from here */
+static char *lname	= NULL;	/* name of the log */
+static char *sname	= NULL;	/* name of the index */
+static struct stat lsb;		/* of the log */
+
+/*
+ * block being made
+*/
+static Buf keys;		/* u64 hashes */
+static Block bnew;
+
+enum {
+	S_NONE		= 0,
+	S_USE		= 1,
+	S_MAKE		= 2
+};
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+void skip_query(const char *, const char *, const char *);
+int skip_begin(const char *);
+off_t skip_tail(void);
+off_t skip_next(off_t);
+void skip_line(const char *);
+void skip_end(void);
+static uint64_t keyhash(int, const char *, size_t);
+static int inbloom(Block *, uint64_t);
+static int maymatch(Block *);
+static void addkey(int, const char *);
+static void close_block(off_t);
+static uint64_t filehash(off_t, size_t);
+static int load(void);
+static void save(void);
+static void clear(void);
+
+
+/********************************************
+ * set the query
+ ********************************************
+ *
+ * same order as match(): the sender, or else the receiver, or
+ * else the date. nothing is skipped without one of them.
+ *
+*/
+void skip_query (const char *sender, const char *rcpt, const char *date)
+{
+	if (sender != NULL && *sender != '\0') {
+		qtype = FROM;
+		qstr = sender;
+	}
+	else if (rcpt != NULL && *rcpt != '\0') {
+		qtype = TO;
+		qstr = rcpt;
+	}
+	else if (date != NULL) {
+		qtype = DATE;
+		qstr = date;
+	}
+}
+
+/********************************************
+ * bloom filter
+ ********************************************
+*/
+uint64_t keyhash (int type, const char *p, size_t n)
+{
+	uint64_t h = strhash(p, n);
+
+	return type == FROM ? h : h ^ 0x9e3779b97f4a7c15ULL;
+}
+
+int inbloom (Block *b, uint64_t h)
+{
+	uint64_t h2 = (h >> 32) | 1;
+
+	for (int i = 0; i < BLOOM_K; i++, h += h2) {
+		uint64_t bit = h & (b->bits - 1);
+
+		if (!(b->bloom[bit >> 3] & (1 << (bit & 7)))) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * 0 if no message of the block can match the query
+*/
+int maymatch (Block *b)
+{
+	size_t n = strlen(qstr);
+	size_t s = 0;
+
+	if (qtype == DATE) {
+		return strncmp(qstr, b->min, n) >= 0 && strncmp(qstr, b->max, n) <= 0;
+	}
+	for (int i = 0; i < NPREFIX && prefix[i] <= n; i++) {
+		s = prefix[i];
+	}
+	if (s == 0 || b->bits == 0) {
+		return 1;
+	}
+
+	return inbloom(b, keyhash(qtype, qstr, s));
+}
+
+/********************************************
+ * begin a log
+ ********************************************
+ *
+ * returns 1 if its index is used, blocks are skipped by
+ * skip_next() then. the index is made (from skip_tail() on) by
+ * skip_line() and skip_end() if the log is a regular file.
+ *
+*/
+int skip_begin (const char *file)
+{
+	clear();
+	if (stat(file, &lsb) != 0 || !S_ISREG(lsb.st_mode)) {
+		return 0;
+	}
+
+	Estrdup(lname, file);
+	Emalloc(sname, strlen(file) + sizeof(SKIP_SUFFIX));
+	sprintf(sname, "%s%s", file, SKIP_SUFFIX);
+	memset(&bnew, 0, sizeof(bnew));
+	keys.len = 0;
+	tail = 0;
+
+	switch (load()) {
+	case S_USE:
+		mode = S_USE;
+		tail = lsb.st_size;
+		return 1;
+	case S_MAKE:
+		/* appended, the blocks before "tail" are kept */
+		mode = S_MAKE;
+		bnew.offset = tail;
+		return 1;
+	}
+
+	mode = S_MAKE;
+
+	return 0;
+}
+
+/*
+ * where the log has to be read from to bring the index up to date
+*/
+off_t skip_tail (void)
+{
+	return tail;
+}
+
+/********************************************
+ * next offset to read
+ ********************************************
+ *
+ * "off" is the offset of the next line. if it starts a block which
+ * can not match, the offset after the blocks skipped is returned.
+ *
+*/
+off_t skip_next (off_t off)
+{
+	off_t to = off;
+
+	if (mode == S_NONE || qtype < 0) {
+		return off;
+	}
+	while (cur < nblk && blk[cur].offset + blk[cur].length <= off) {
+		cur++;
+	}
+	while (cur < nblk && blk[cur].offset == to && blk[cur].offset < tail
+	       && !maymatch(&blk[cur])) {
+		to += blk[cur].length;
+		ST_ADD(skipped, blk[cur].length);
+		cur++;
+	}
+
+	return to;
+}
+
+/********************************************
+ * make the index by the lines read
+ ********************************************
+*/
+void addkey (int type, const char *p)
+{
+	size_t n = strlen(p);
+	uint64_t h;
+
+	for (int i = 0; i < NPREFIX && prefix[i] < n; i++) {
+		h = keyhash(type, p, prefix[i]);
+		bufput(&keys, &h, sizeof(h));
+	}
+	h = keyhash(type, p, n);
+	bufput(&keys, &h, sizeof(h));
+}
+
+void skip_line (const char *line)
+{
+	const char *p;
+	off_t off = getoffset();
+
+	if (mode != S_MAKE || off < tail) {
+		return;
+	}
+
+	if (!strncmp(line, STR_SRC, strlen(STR_SRC))) {
+		if (off - bnew.offset >= SKIP_BLOCK) {
+			close_block(off);
+		}
+		bnew.messages++;
+		addkey(FROM, getfield(0, FROM));
+	}
+	else if (!strncmp(line, STR_DST, strlen(STR_DST))) {
+		for (int i = 0; i < getnfield(TO); i++) {
+			addkey(TO, getfield(i, TO));
+		}
+	}
+	else if (!strncmp(line, STR_DATE, strlen(STR_DATE))) {
+		p = getfield(0, DATE);
+		if (*bnew.min == '\0' || strncmp(p, bnew.min, DATE_MAX - 1) < 0) {
+			strncpy(bnew.min, p, DATE_MAX - 1);
+		}
+		if (strncmp(p, bnew.max, DATE_MAX - 1) > 0) {
+			strncpy(bnew.max, p, DATE_MAX - 1);
+		}
+	}
+}
+
+/*
+ * the block ends at "off", its bloom filter is sized by the keys
+*/
+void close_block (off_t off)
+{
+	uint64_t *h = (uint64_t *)keys.data;
+	size_t n = keys.len / sizeof(uint64_t);
+
+	bnew.length = off - bnew.offset;
+	for (bnew.bits = 64; bnew.bits < n * BLOOM_BITS; bnew.bits *= 2)
+		;
+	Calloc(bnew.bloom, bnew.bits / 8, 1);
+	for (size_t i = 0; i < n; i++) {
+		uint64_t k = h[i];
+		uint64_t k2 = (k >> 32) | 1;
+
+		for (int j = 0; j < BLOOM_K; j++, k += k2) {
+			uint64_t bit = k & (bnew.bits - 1);
+
+			bnew.bloom[bit >> 3] |= 1 << (bit & 7);
+		}
+	}
+
+	if ((nblk & (nblk - 1)) == 0) {
+		Realloc(blk, (nblk ? nblk * 2 : 1) * sizeof(Block));
+	}
+	blk[nblk++] = bnew;
+
+	memset(&bnew, 0, sizeof(bnew));
+	bnew.offset = off;
+	keys.len = 0;
+}
+
+/********************************************
+ * end of a log
+ ********************************************
+*/
+void skip_end (void)
+{
+	if (mode == S_MAKE) {
+		if (getnext() > bnew.offset) {
+			close_block(getnext());
+		}
+		save();
+	}
+	clear();
+}
+
+/********************************************
+ * read/write the index
+ ********************************************
+*/
+/*
+ * hash of HASH_SIZE bytes of the log at most, from "off"
+*/
+uint64_t filehash (off_t off, size_t n)
+{
+	char b[HASH_SIZE];
+	FILE *in;
+
+	if (n > HASH_SIZE) {
+		n = HASH_SIZE;
+	}
+	if ((in = fopen(lname, "r")) == NULL) {
+		return 0;
+	}
+	if (fseeko(in, off, SEEK_SET) != 0) {
+		n = 0;
+	}
+	n = fread(b, 1, n, in);
+	Fclose(in);
+
+	return strhash(b, n);
+}
+
+/*
+ * S_USE if the index is up to date, S_MAKE if the log was appended
+ * ("tail" is set), 0 if it has to be made again
+*/
+int load (void)
+{
+	FILE *in;
+	char m[sizeof(SKIP_MAGIC) - 1];
+	uint32_t h[2];
+	uint64_t v[8];	/* size, mtime, dev, inode, tail, messages, hashes */
+	int rc;
+	uint32_t size;
+	uint64_t msgs = 0;	/* of the blocks, has to be v[5] */
+	Block *b;
+
+	if ((in = fopen(sname, "r")) == NULL) {
+		return 0;
+	}
+	if (fread(m, 1, sizeof(m), in) != sizeof(m)
+	    || memcmp(m, SKIP_MAGIC, sizeof(m))
+	    || fread(h, sizeof(uint32_t), 2, in) != 2 || h[0] != SKIP_VERSION
+	    || fread(v, sizeof(uint64_t), 8, in) != 8
+	    || v[2] != lsb.st_dev || v[3] != lsb.st_ino) {
+		Fclose(in);
+		return 0;
+	}
+
+	if (v[0] == lsb.st_size && (int64_t)v[1] == lsb.st_mtime) {
+		rc = S_USE;
+	}
+	else if (v[0] < lsb.st_size && v[4] <= v[0]
+		 && v[6] == filehash(0, v[0])
+		 && v[7] == filehash(v[4] > HASH_SIZE ? v[4] - HASH_SIZE : 0,
+				     v[4] > HASH_SIZE ? HASH_SIZE : v[4])) {
+		rc = S_MAKE;
+		tail = v[4];
+	}
+	else {
+		Fclose(in);
+		return 0;
+	}
+
+	/* close_block() doubles it at powers of 2 */
+	for (size = 1; size < h[1]; size *= 2)
+		;
+	Calloc(blk, size, sizeof(Block));
+	for (nblk = 0; nblk < h[1]; nblk++) {
+		b = &blk[nblk];
+		if (fread(&b->offset, sizeof(uint64_t), 1, in) != 1
+		    || fread(&b->length, sizeof(uint64_t), 1, in) != 1
+		    || fread(&b->bits, sizeof(uint32_t), 1, in) != 1
+		    || fread(&b->messages, sizeof(uint32_t), 1, in) != 1
+		    || fread(b->min, 1, DATE_MAX, in) != DATE_MAX
+		    || fread(b->max, 1, DATE_MAX, in) != DATE_MAX) {
+			break;
+		}
+		b->min[DATE_MAX - 1] = b->max[DATE_MAX - 1] = '\0';
+
+		/*
+		 * a power of 2 from 64, under twice the keys a block
+		 * of "length" bytes can give (see close_block())
+		*/
+		if (b->length > v[0] || b->bits < 64
+		    || (b->bits & (b->bits - 1)) != 0
+		    || (b->bits > 64 && b->bits / 2 >= b->length * BLOOM_BITS)) {
+			break;
+		}
+		Emalloc(b->bloom, b->bits / 8 + 1);
+		if (fread(b->bloom, 1, b->bits / 8, in) != b->bits / 8) {
+			Efree(b->bloom);
+			break;
+		}
+		msgs += b->messages;
+	}
+	Fclose(in);
+
+	/*
+	 * the blocks kept for an appended log have to be the ones written
+	*/
+	if (nblk != h[1] || msgs != v[5]) {
+		sys_err(" **warning** broken skip index, made again",
+			SOURCE, __LINE__, 0);
+		while (nblk > 0) {
+			Efree(blk[--nblk].bloom);
+		}
+		Efree(blk);
+		blk = NULL;
+		return 0;
+	}
+
+	/*
+	 * the last block is made again from "tail"
+	*/
+	while (rc == S_MAKE && nblk > 0 && blk[nblk - 1].offset >= tail) {
+		Efree(blk[--nblk].bloom);
+	}
+
+	return rc;
+}
+
+void save (void)
+{
+	FILE *out;
+	uint32_t h[2] = {SKIP_VERSION, nblk};
+	uint64_t v[8];
+
+	/*
+	 * the size read, the log may have been appended meanwhile
+	*/
+	v[0] = nblk ? blk[nblk - 1].offset + blk[nblk - 1].length : 0;
+	v[1] = lsb.st_mtime;
+	v[2] = lsb.st_dev;
+	v[3] = lsb.st_ino;
+	v[4] = nblk ? blk[nblk - 1].offset : 0;
+	v[5] = 0;
+	for (uint32_t i = 0; i < nblk; i++) {
+		v[5] += blk[i].messages;
+	}
+	v[6] = filehash(0, v[0]);
+	v[7] = filehash(v[4] > HASH_SIZE ? v[4] - HASH_SIZE : 0,
+			v[4] > HASH_SIZE ? HASH_SIZE : v[4]);
+
+	if ((out = fopen(sname, "w")) == NULL) {
+		sys_err(" **warning** can not write the skip index",
+			SOURCE, __LINE__, 0);
+		return;
+	}
+	fwrite(SKIP_MAGIC, 1, sizeof(SKIP_MAGIC) - 1, out);
+	fwrite(h, sizeof(uint32_t), 2, out);
+	fwrite(v, sizeof(uint64_t), 8, out);
+	for (uint32_t i = 0; i < nblk; i++) {
+		fwrite(&blk[i].offset, sizeof(uint64_t), 1, out);
+		fwrite(&blk[i].length, sizeof(uint64_t), 1, out);
+		fwrite(&blk[i].bits, sizeof(uint32_t), 1, out);
+		fwrite(&blk[i].messages, sizeof(uint32_t), 1, out);
+		fwrite(blk[i].min, 1, DATE_MAX, out);
+		fwrite(blk[i].max, 1, DATE_MAX, out);
+		fwrite(blk[i].bloom, 1, blk[i].bits / 8, out);
+	}
+	Fclose(out);
+}
+
+void clear (void)
+{
+	for (uint32_t i = 0; i < nblk; i++) {
+		Efree(blk[i].bloom);
+	}
+	Efree(blk);
+	Efree(sname);
+	Efree(lname);
+	blk = NULL;
+	sname = lname = NULL;
+	nblk = cur = 0;
+	mode = S_NONE;
+}
+
+/* end of source */
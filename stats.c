@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  stats.c
+#contents :  st_now(), st_merge(), st_print()
+#version  :  1.00
+#higher module : mview.c, getlog.c
+#lower  module : none
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  per-phase counters and timers
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * the counters and timers are updated through ST_ADD(), ST_BEGIN()
+ * and ST_END() of mview.h, which do nothing but test "stflag" when
+ * "--stats-json" is not given.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#include <pthread.h>
+#include <sys/resource.h>
+#include "mview.h"
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"stats.c"
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+int stflag	= 0;
+THREAD Stats st;
+
+static Stats sum;	/* of the threads finished */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *phase[NPHASE] = {
+	"read", "split", "match", "print", "dump"
+};
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+uint64_t st_now(void);
+void st_merge(void);
+void st_print(FILE *, uint64_t);
+
+
+/********************************************
+ * monotonic clock in nanoseconds
+ ********************************************
+*/
+uint64_t st_now (void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+
+	return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/********************************************
+ * add statistics of this thread to the sum
+ ********************************************
+*/
+void st_merge (void)
+{
+	pthread_mutex_lock(&lock);
+	sum.bytes += st.bytes;
+	sum.lines += st.lines;
+	sum.messages += st.messages;
+	sum.matches += st.matches;
+	sum.dumps += st.dumps;
+	sum.skipped += st.skipped;
+	sum.grow_line += st.grow_line;
+	sum.grow_field += st.grow_field;
+	sum.shrink += st.shrink;
+	if (sum.line_size < st.line_size) {
+		sum.line_size = st.line_size;
+	}
+	if (sum.field_size < st.field_size) {
+		sum.field_size = st.field_size;
+	}
+	for (int i = 0; i < NPHASE; i++) {
+		sum.ns[i] += st.ns[i];
+	}
+	memset(&st, 0, sizeof(st));
+	pthread_mutex_unlock(&lock);
+}
+
+/********************************************
+ * print out statistics as json
+ ********************************************
+*/
+void st_print (FILE *o, uint64_t elapsed)
+{
+	struct rusage ru;
+	double sec = elapsed / 1e9;
+
+	if (sec <= 0) {
+		sec = 1e-9;
+	}
+	getrusage(RUSAGE_SELF, &ru);
+	st_merge();
+	st = sum;
+
+	fprintf(o, "{\"elapsed_ns\": %llu, ", (unsigned long long)elapsed);
+	fprintf(o, "\"bytes\": %llu, \"lines\": %llu, \"messages\": %llu, "
+		"\"matches\": %llu, \"dumps\": %llu, \"skipped\": %llu, ",
+		(unsigned long long)st.bytes, (unsigned long long)st.lines,
+		(unsigned long long)st.messages, (unsigned long long)st.matches,
+		(unsigned long long)st.dumps, (unsigned long long)st.skipped);
+	fprintf(o, "\"mb_per_s\": %.1f, \"messages_per_s\": %.0f, ",
+		st.bytes / (1024.0 * 1024.0) / sec, st.messages / sec);
+	fprintf(o, "\"grow\": {\"line\": %llu, \"line_bytes\": %llu, "
+		"\"field\": %llu, \"field_bytes\": %llu, \"shrink\": %llu}, ",
+		(unsigned long long)st.grow_line, (unsigned long long)st.line_size,
+		(unsigned long long)st.grow_field, (unsigned long long)st.field_size,
+		(unsigned long long)st.shrink);
+	fprintf(o, "\"time_ns\": {");
+	for (int i = 0; i < NPHASE; i++) {
+		fprintf(o, "%s\"%s\": %llu", i ? ", " : "", phase[i],
+			(unsigned long long)st.ns[i]);
+	}
+	fprintf(o, "}, \"max_rss_kb\": %ld}\n", ru.ru_maxrss);
+}
+
+/* end of source */
@@ -0,0 +1,801 @@
+/*
+ * Copyright (c) 2005, Tsuyoshi Sakamoto <skmt.japan@gmail.com>,
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE. 
+*/
+
+/*
+###############################################################################
+#program  :  Mail Statistics
+#system   :  unix, C language
+#file     :  uring.c
+#contents :  ur_open(), ur_start(), ur_next(), getring(), ur_dump(), ur_close()
+#version  :  1.00
+#higher module : mview.c, pipe.c
+#lower  module : getlog.c, io_uring (linux)
+###############################################################################
+#maintenance history
+#create  :  2026/10/19  io_uring read and write path
+#update  :  2026/10/19  cancel the reads left by "--limit", unmap the sqes
+#update  :  2026/10/19  complete a short read from an aligned offset
+#update  :  2026/10/19  write the rest of a message after a short write
+#update  :  yyyy/mm/dd  - author -         - comments -
+###############################################################################
+*/
+
+/*
+ * two rings are set up by the raw system calls (no liburing).
+ *
+ * reading: NREAD reads of READ_SIZE are kept in flight ahead of the
+ * parser, chunk k in buffer k % NREAD. the file is opened with
+ * O_DIRECT if a probe read succeeds, the buffers are page aligned.
+ * a chunk is read again from the buffer, resubmitted only when the
+ * caller asks for the next one. the reads still in flight when a file
+ * is left early ("--limit") are cancelled and waited for before the
+ * buffers are used again or freed.
+ *
+ * writing: a message written down is queued as OPENAT into a slot of
+ * a sparse fixed file table linked to the WRITE of the slot. they go
+ * to the kernel NSLOT/4 at a time. the CLOSE of the slot is queued
+ * when the WRITE completes, after a WRITE of the rest if it was short,
+ * the buffers are freed on completion of all.
+ *
+ * ur_open() returns 0 when the kernel does not support any of it,
+ * the callers keep the regular path then.
+*/
+
+/********************************************
+ * include file
+ ********************************************
+*/
+#define _GNU_SOURCE		/* O_DIRECT */
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "mview.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+/********************************************
+ * macro
+ ********************************************
+*/
+#define SOURCE		"uring.c"
+
+#define NREAD		8
+#define READ_SIZE	(1024 * 1024)
+#define ALIGN		4096
+#define NSLOT		64		/* messages being written down */
+#define NENTRY		256		/* submission queue */
+
+#define DUMP_OPEN	0
+#define DUMP_WRITE	1
+#define DUMP_CLOSE	2
+
+
+#ifdef __linux__
+/********************************************
+ * type definition
+ ********************************************
+*/
+typedef struct _ring {
+	int fd;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	void *sq_map;
+	void *cq_map;
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqe_size;
+	unsigned queued;	/* sqes not submitted yet */
+} Ring;
+
+typedef struct _chunk {
+	char *buf;
+	off_t off;
+	ssize_t res;		/* -1 while in flight */
+} Chunk;
+
+typedef struct _dump {
+	char *name;
+	char *data;
+	size_t size;
+	size_t done;		/* written */
+	int left;		/* completions to wait for */
+} Dump;
+
+
+/********************************************
+ * global variable
+ ********************************************
+*/
+static Ring rring;		/* reading, one thread */
+static Ring wring;		/* writing down, main thread */
+static int ready	= 0;
+
+static Chunk chunk[NREAD];
+static int rfd		= -1;	/* file being read */
+static off_t rsize	= 0;	/* size of the file */
+static off_t rnext	= 0;	/* offset of the next read to submit */
+static unsigned long rseq = 0;	/* chunk to hand out next */
+static int rhold	= 0;	/* chunk "rseq - 1" is handed out */
+static Buf carry;		/* partial line of getring() */
+static size_t cpos	= 0;	/* position in the chunk handed out */
+static const char *cbuf	= NULL;
+static size_t clen	= 0;
+
+static Dump dump[NSLOT];
+static int nfree	= NSLOT;
+#endif
+
+/********************************************
+ * prototype
+ ********************************************
+*/
+int ur_open(void);
+int ur_start(const char *);
+ssize_t ur_next(const char **);
+char *getring(FILE *);
+void ur_dump(const char *, char *, size_t);
+void ur_close(void);
+
+#ifdef __linux__
+static int ring_init(Ring *, unsigned);
+static void ring_free(Ring *);
+static struct io_uring_sqe *ring_sqe(Ring *);
+static int ring_enter(Ring *, unsigned);
+static int ring_reap(Ring *, struct io_uring_cqe *);
+static int probe(void);
+static void submit(int);
+static void drain(void);
+static void dump_next(int);
+static void dump_done(struct io_uring_cqe *);
+static void dump_wait(unsigned);
+
+
+/********************************************
+ * ring
+ ********************************************
+*/
+int ring_init (Ring *r, unsigned entries)
+{
+	struct io_uring_params p;
+	char *sq;
+	char *cq;
+
+	memset(&p, 0, sizeof(p));
+	memset(r, 0, sizeof(Ring));
+	if ((r->fd = syscall(__NR_io_uring_setup, entries, &p)) < 0) {
+		return 0;
+	}
+
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_size > r->sq_size) {
+			r->sq_size = r->cq_size;
+		}
+		r->cq_size = r->sq_size;
+	}
+	r->sq_map = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_map == MAP_FAILED) {
+		close(r->fd);
+		return 0;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_map = r->sq_map;
+	}
+	else {
+		r->cq_map = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_map == MAP_FAILED) {
+			munmap(r->sq_map, r->sq_size);
+			close(r->fd);
+			return 0;
+		}
+	}
+	r->sqe_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqe = mmap(NULL, r->sqe_size, PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqe == MAP_FAILED) {
+		r->sqe = NULL;
+		ring_free(r);
+		return 0;
+	}
+
+	sq = r->sq_map;
+	cq = r->cq_map;
+	r->sq_head = (unsigned *)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned *)(sq + p.sq_off.array);
+	r->cq_head = (unsigned *)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqe = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+	return 1;
+}
+
+void ring_free (Ring *r)
+{
+	if (r->sq_map == NULL) {
+		return;
+	}
+	if (r->sqe != NULL) {
+		munmap(r->sqe, r->sqe_size);
+	}
+	if (r->cq_map != r->sq_map && r->cq_map != NULL) {
+		munmap(r->cq_map, r->cq_size);
+	}
+	munmap(r->sq_map, r->sq_size);
+	close(r->fd);
+	memset(r, 0, sizeof(Ring));
+}
+
+/*
+ * next free sqe, the queue is submitted first if it is full
+*/
+struct io_uring_sqe *ring_sqe (Ring *r)
+{
+	struct io_uring_sqe *e;
+	unsigned tail = *r->sq_tail;
+
+	while (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE)
+	       > *r->sq_mask) {
+		ring_enter(r, 0);
+	}
+	e = &r->sqe[tail & *r->sq_mask];
+	memset(e, 0, sizeof(*e));
+	r->sq_array[tail & *r->sq_mask] = tail & *r->sq_mask;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	r->queued++;
+
+	return e;
+}
+
+/*
+ * submit what is queued, wait for "wait" completions
+*/
+int ring_enter (Ring *r, unsigned wait)
+{
+	int n;
+
+	do {
+		n = syscall(__NR_io_uring_enter, r->fd, r->queued, wait,
+			    wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+	} while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		sys_err(" ***error*** io_uring_enter failure", SOURCE, __LINE__, 1);
+	}
+	r->queued -= n;
+
+	return n;
+}
+
+/*
+ * take a completion if any
+*/
+int ring_reap (Ring *r, struct io_uring_cqe *c)
+{
+	unsigned head = *r->cq_head;
+
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	*c = r->cqe[head & *r->cq_mask];
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+/*
+ * the kernel has to know the operations used here
+*/
+int probe (void)
+{
+	struct io_uring_probe *p;
+	size_t size = sizeof(*p) + 256 * sizeof(struct io_uring_probe_op);
+	int op[] = {IORING_OP_READ, IORING_OP_WRITE, IORING_OP_OPENAT, IORING_OP_CLOSE};
+	int ok;
+
+	Emalloc(p, size);
+	ok = syscall(__NR_io_uring_register, wring.fd,
+		     IORING_REGISTER_PROBE, p, 256) == 0;
+	for (int i = 0; ok && i < sizeof(op) / sizeof(op[0]); i++) {
+		ok = op[i] <= p->last_op
+		     && (p->ops[op[i]].flags & IO_URING_OP_SUPPORTED);
+	}
+	Efree(p);
+
+	return ok;
+}
+#endif
+
+/********************************************
+ * set up the rings
+ ********************************************
+*/
+int ur_open (void)
+{
+#ifdef __linux__
+	struct io_uring_rsrc_register reg;
+
+	if (ready) {
+		return 1;
+	}
+	if (!ring_init(&rring, NREAD * 2)) {
+		return 0;
+	}
+	if (!ring_init(&wring, NENTRY)) {
+		ring_free(&rring);
+		return 0;
+	}
+
+	memset(&reg, 0, sizeof(reg));
+	reg.nr = NSLOT;
+	reg.flags = IORING_RSRC_REGISTER_SPARSE;
+	if (!probe()
+	    || syscall(__NR_io_uring_register, wring.fd,
+		       IORING_REGISTER_FILES2, &reg, sizeof(reg)) < 0) {
+		ring_free(&rring);
+		ring_free(&wring);
+		return 0;
+	}
+
+	for (int i = 0; i < NREAD; i++) {
+		if (posix_memalign((void **)&chunk[i].buf, ALIGN, READ_SIZE)) {
+			sys_err(" **error** posix_memalign error, no memory is available.",
+				SOURCE, __LINE__, 0);
+			exit(1);
+		}
+	}
+	ready = 1;
+
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+#ifdef __linux__
+/********************************************
+ * submit the read of chunk "k"
+ ********************************************
+*/
+void submit (int k)
+{
+	struct io_uring_sqe *e;
+
+	chunk[k].off = rnext;
+	chunk[k].res = -1;
+	e = ring_sqe(&rring);
+	e->opcode = IORING_OP_READ;
+	e->fd = rfd;
+	e->addr = (uintptr_t)chunk[k].buf;
+	e->len = READ_SIZE;
+	e->off = rnext;
+	e->user_data = k;
+	rnext += READ_SIZE;
+}
+
+/********************************************
+ * leave the file being read
+ ********************************************
+ *
+ * the reads in flight are cancelled, and their completions and the
+ * ones of the cancels (user_data NREAD + k) are waited for, whether
+ * the cancel found the read or not.
+ *
+*/
+void drain (void)
+{
+	struct io_uring_sqe *e;
+	struct io_uring_cqe c;
+	int left = 0;
+
+	if (rfd < 0) {
+		return;
+	}
+	for (int k = 0; k < NREAD; k++) {
+		if (chunk[k].res < 0) {
+			e = ring_sqe(&rring);
+			e->opcode = IORING_OP_ASYNC_CANCEL;
+			e->addr = k;
+			e->user_data = NREAD + k;
+			left += 2;
+		}
+	}
+	while (left > 0) {
+		if (!ring_reap(&rring, &c)) {
+			ring_enter(&rring, 1);
+			continue;
+		}
+		if (c.user_data < NREAD) {
+			chunk[c.user_data].res = 0;
+		}
+		left--;
+	}
+	close(rfd);
+	rfd = -1;
+}
+#endif
+
+/********************************************
+ * start reading a file
+ ********************************************
+ *
+ * returns the descriptor, or -1 if the file is not to be read by
+ * the ring (not a regular file, or no ring).
+ *
+*/
+int ur_start (const char *file)
+{
+#ifdef __linux__
+	struct stat sb;
+	int fd;
+
+	if (!ready || stat(file, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+		return -1;
+	}
+	drain();
+
+	/*
+	 * O_DIRECT only if the file system takes an aligned read
+	*/
+	if ((fd = open(file, O_RDONLY | O_DIRECT)) >= 0
+	    && pread(fd, chunk[0].buf, ALIGN, 0) < 0) {
+		close(fd);
+		fd = -1;
+	}
+	if (fd < 0 && (fd = open(file, O_RDONLY)) < 0) {
+		return -1;
+	}
+
+	rfd = fd;
+	rsize = sb.st_size;
+	rnext = 0;
+	rseq = 0;
+	rhold = 0;
+	cpos = clen = 0;
+	carry.len = 0;
+	for (int k = 0; k < NREAD && rnext < rsize; k++) {
+		submit(k);
+	}
+	ring_enter(&rring, 0);
+
+	return fd;
+#else
+	return -1;
+#endif
+}
+
+/********************************************
+ * next chunk of the file in order
+ ********************************************
+ *
+ * the chunk is valid until the next call. returns 0 at the end of
+ * the file, which is closed then.
+ *
+*/
+ssize_t ur_next (const char **p)
+{
+#ifdef __linux__
+	struct io_uring_cqe c;
+	int k;
+	ssize_t n;
+
+	/*
+	 * the chunk handed out last is free now, read ahead into it
+	*/
+	if (rhold) {
+		rhold = 0;
+		if (rnext < rsize) {
+			submit((rseq - 1) % NREAD);
+			ring_enter(&rring, 0);
+		}
+	}
+
+	k = rseq % NREAD;
+	if ((off_t)rseq * READ_SIZE >= rsize) {
+		close(rfd);
+		rfd = -1;
+		return 0;
+	}
+	while (chunk[k].res < 0) {
+		if (!ring_reap(&rring, &c)) {
+			ring_enter(&rring, 1);
+			continue;
+		}
+		if (c.res < 0) {
+			errno = -c.res;
+			sys_err(" ***error*** read failure", SOURCE, __LINE__, 1);
+		}
+		chunk[c.user_data].res = c.res;
+	}
+
+	/*
+	 * a short read before the end of the file is completed here,
+	 * from the aligned offset below it (O_DIRECT takes no other)
+	*/
+	n = chunk[k].res;
+	while (n < READ_SIZE && chunk[k].off + n < rsize) {
+		size_t a = n & ~(size_t)(ALIGN - 1);
+		ssize_t m = pread(rfd, chunk[k].buf + a, READ_SIZE - a,
+				  chunk[k].off + a);
+
+		if (m < 0 && errno == EINTR) {
+			continue;
+		}
+		if (m < 0) {
+			sys_err(" ***error*** read failure", SOURCE, __LINE__, 1);
+		}
+		if (a + m <= n) {
+			break;		/* truncated */
+		}
+		n = a + m;
+	}
+
+	*p = chunk[k].buf;
+	rseq++;
+	rhold = 1;
+
+	return n;
+#else
+	return 0;
+#endif
+}
+
+/********************************************
+ * get log from the ring
+ ********************************************
+ *
+ * same as getlog() on the file given to ur_start(), the argument
+ * is not used.
+ *
+*/
+char *getring (FILE *in)
+{
+#ifdef __linux__
+	const char *p;
+	const char *e;
+	ssize_t n;
+
+	for (;;) {
+		if (cpos < clen) {
+			p = cbuf + cpos;
+			e = memchr(p, NEWLINE, clen - cpos);
+			if (e == NULL) {
+				bufput(&carry, p, clen - cpos);
+				cpos = clen;
+				continue;
+			}
+			cpos = e + 1 - cbuf;
+			if (carry.len == 0) {
+				return setlog(p, e - p);
+			}
+			bufput(&carry, p, e - p);
+			n = carry.len;
+			carry.len = 0;
+			return setlog(carry.data, n);
+		}
+		if ((n = ur_next(&cbuf)) <= 0) {
+			break;
+		}
+		clen = n;
+		cpos = 0;
+	}
+
+	/*
+	 * the last line without NEWLINE
+	*/
+	if (carry.len > 0) {
+		n = carry.len;
+		carry.len = 0;
+		return setlog(carry.data, n);
+	}
+#endif
+	return NULL;
+}
+
+#ifdef __linux__
+/********************************************
+ * completion of a message written down
+ ********************************************
+*/
+void dump_done (struct io_uring_cqe *c)
+{
+	int slot = c->user_data >> 2;
+	Dump *d = &dump[slot];
+	int op = c->user_data & 3;
+
+	if (c->res < 0 && c->res != -ECANCELED) {
+		errno = -c->res;
+		sys_err(op == DUMP_OPEN ? " ***error*** file open failure"
+			: (op == DUMP_WRITE ? " ***error*** write failure"
+			   : " ***error*** file close failure"),
+			SOURCE, __LINE__, 0);
+		fprintf(stderr, "%s: %s\n", d->name, strerror(errno));
+		if (op == DUMP_WRITE) {
+			d->done = d->size;	/* close */
+			dump_next(slot);
+		}
+	}
+	else if (op == DUMP_WRITE && c->res >= 0) {
+		d->done += c->res;
+		if (c->res == 0 && d->done < d->size) {
+			sys_err(" ***error*** short write", SOURCE, __LINE__, 0);
+			d->done = d->size;	/* no progress, close */
+		}
+		dump_next(slot);
+	}
+
+	if (--d->left == 0) {
+		Efree(d->name);
+		Efree(d->data);
+		d->name = d->data = NULL;
+		nfree++;
+	}
+}
+
+/*
+ * queue the WRITE of the rest of slot "slot", or its CLOSE when all
+ * is written
+*/
+void dump_next (int slot)
+{
+	struct io_uring_sqe *e;
+	Dump *d = &dump[slot];
+
+	e = ring_sqe(&wring);
+	if (d->done < d->size) {
+		e->opcode = IORING_OP_WRITE;
+		e->fd = slot;
+		e->addr = (uintptr_t)(d->data + d->done);
+		e->len = d->size - d->done;
+		e->off = d->done;
+		e->flags = IOSQE_FIXED_FILE;
+		e->user_data = (slot << 2) | DUMP_WRITE;
+	}
+	else {
+		e->opcode = IORING_OP_CLOSE;
+		e->file_index = slot + 1;
+		e->user_data = (slot << 2) | DUMP_CLOSE;
+	}
+	d->left++;
+}
+
+/*
+ * submit and wait until "n" slots are free
+*/
+void dump_wait (unsigned n)
+{
+	struct io_uring_cqe c;
+
+	ring_enter(&wring, 0);
+	while (nfree < n) {
+		if (ring_reap(&wring, &c)) {
+			dump_done(&c);
+		}
+		else {
+			ring_enter(&wring, 1);
+		}
+	}
+}
+#endif
+
+/********************************************
+ * write down a message
+ ********************************************
+ *
+ * "data" is taken over and freed when it is written.
+ *
+*/
+void ur_dump (const char *name, char *data, size_t size)
+{
+#ifdef __linux__
+	struct io_uring_sqe *e;
+	struct io_uring_cqe c;
+	Dump *d = NULL;
+	int slot;
+
+	while (ring_reap(&wring, &c)) {
+		dump_done(&c);
+	}
+	if (nfree == 0) {
+		dump_wait(1);
+	}
+	for (slot = 0; slot < NSLOT; slot++) {
+		if (dump[slot].name == NULL) {
+			d = &dump[slot];
+			break;
+		}
+	}
+	nfree--;
+	Estrdup(d->name, name);
+	d->data = data;
+	d->size = size;
+	d->done = 0;
+	d->left = 1;
+
+	e = ring_sqe(&wring);
+	e->opcode = IORING_OP_OPENAT;
+	e->fd = AT_FDCWD;
+	e->addr = (uintptr_t)d->name;
+	e->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+	e->len = 0644;
+	e->file_index = slot + 1;
+	e->flags = IOSQE_IO_LINK;
+	e->user_data = (slot << 2) | DUMP_OPEN;
+	dump_next(slot);
+
+	/*
+	 * the kernel gets them NSLOT/4 messages at a time
+	*/
+	if (wring.queued >= 2 * NSLOT / 4) {
+		ring_enter(&wring, 0);
+	}
+#endif
+}
+
+/********************************************
+ * wait for all and tear down
+ ********************************************
+*/
+void ur_close (void)
+{
+#ifdef __linux__
+	if (!ready) {
+		return;
+	}
+	dump_wait(NSLOT);
+	drain();
+	ring_free(&rring);
+	ring_free(&wring);
+	for (int i = 0; i < NREAD; i++) {
+		free(chunk[i].buf);
+	}
+	buffree(&carry);
+	ready = 0;
+#endif
+}
+
+/* end of source */